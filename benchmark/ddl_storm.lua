@@ -0,0 +1,26 @@
+-- Creates, alters, renames, and drops tables. Each DDL statement reads and writes .frm files, which EdgelessDB
+-- redirects to its store.
+
+sysbench.cmdline.options = {
+  tables = {"Number of tables of the other workloads (ignored)", 1},
+  table_size = {"Number of rows per table of the other workloads (ignored)", 10000},
+}
+
+function thread_init()
+  drv = sysbench.sql.driver()
+  con = drv:connect()
+  counter = 0
+end
+
+function thread_done()
+  con:disconnect()
+end
+
+function event()
+  counter = counter + 1
+  local name = string.format("ddl_storm_%d_%d", sysbench.tid, counter)
+  con:query("CREATE TABLE " .. name .. " (id INT PRIMARY KEY, k INT NOT NULL, c CHAR(120)) ENGINE=rocksdb")
+  con:query("ALTER TABLE " .. name .. " ADD INDEX k (k)")
+  con:query("RENAME TABLE " .. name .. " TO " .. name .. "_renamed")
+  con:query("DROP TABLE " .. name .. "_renamed")
+end
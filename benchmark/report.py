@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Summarizes the results of run.sh and breaks down the overhead of EdgelessDB.
+
+usage: report.py [results dir]
+"""
+
+import os
+import re
+import sys
+
+FLAVOURS = ['mariadbd-notls', 'mariadbd', 'edb-noenclave', 'edb-enclave']
+DATASETS = ['small', 'large']
+WORKLOADS = ['point_select', 'read_write', 'insert', 'range_scan', 'ddl_storm']
+
+
+def parse(path):
+    """Returns (events per second, p99 latency in ms) of a sysbench output file or None."""
+    try:
+        with open(path) as f:
+            out = f.read()
+    except FileNotFoundError:
+        return None
+    events = re.search(r'total number of events:\s+([\d.]+)', out)
+    time = re.search(r'total time:\s+([\d.]+)s', out)
+    p99 = re.search(r'99th percentile:\s+([\d.]+)', out)
+    if not (events and time and p99):
+        return None
+    return float(events.group(1)) / float(time.group(1)), float(p99.group(1))
+
+
+def events(path):
+    """Returns the total number of events of a sysbench output file or None."""
+    try:
+        with open(path) as f:
+            match = re.search(r'total number of events:\s+([\d.]+)', f.read())
+    except FileNotFoundError:
+        return None
+    return float(match.group(1)) if match else None
+
+
+def syscalls(path):
+    """Returns the number of syscalls that have not been redirected to the store from a metrics snapshot or None."""
+    try:
+        with open(path) as f:
+            out = f.read()
+    except FileNotFoundError:
+        return None
+    total = 0
+    for name, value in re.findall(r'^edb_syscalls_(intercepted|handled)_total\{[^}]*\} (\d+)$', out, re.MULTILINE):
+        total += int(value) if name == 'intercepted' else -int(value)
+    return total
+
+
+def host_syscalls_per_event(results_dir, flavour, dataset, workload):
+    """Returns the host syscalls per sysbench event, which approximates the enclave transitions, or None."""
+    base = os.path.join(results_dir, flavour, f'{dataset}-{workload}')
+    before = syscalls(base + '.before.prom')
+    after = syscalls(base + '.after.prom')
+    count = events(base + '.txt')
+    if None in (before, after) or not count:
+        return None
+    return (after - before) / count
+
+
+def overhead(base, other):
+    """Returns the throughput lost relative to base in percent."""
+    if base is None or other is None:
+        return None
+    return (1 - other / base) * 100
+
+
+def fmt(value, suffix=''):
+    return 'n/a' if value is None else f'{value:.1f}{suffix}'
+
+
+def main():
+    results_dir = sys.argv[1] if len(sys.argv) > 1 else 'results'
+    results = {}
+    for flavour in FLAVOURS:
+        for dataset in DATASETS:
+            for workload in WORKLOADS:
+                results[flavour, dataset, workload] = parse(os.path.join(results_dir, flavour, f'{dataset}-{workload}.txt'))
+
+    def tps(flavour, dataset, workload):
+        r = results[flavour, dataset, workload]
+        return r[0] if r else None
+
+    for dataset in DATASETS:
+        print(f'## Throughput in events/s and p99 latency in ms ({dataset} data set)\n')
+        print('| workload | ' + ' | '.join(FLAVOURS) + ' |')
+        print('|---' * (len(FLAVOURS) + 1) + '|')
+        for workload in WORKLOADS:
+            cells = []
+            for flavour in FLAVOURS:
+                r = results[flavour, dataset, workload]
+                cells.append(f'{r[0]:.0f} / {r[1]:.1f}' if r else 'n/a')
+            print(f'| {workload} | ' + ' | '.join(cells) + ' |')
+        print()
+
+    print('## Overhead breakdown in % of throughput\n')
+    print('* TLS: mariadbd with TLS compared to mariadbd without TLS')
+    print('* edgeless: edb-noenclave compared to mariadbd, mostly the encryption of RocksDB files')
+    print('* ocalls: edb-enclave compared to edb-noenclave on the small data set, which fits into the EPC. This is the cost of')
+    print('  enclave transitions for host syscalls and of the syscall redirection inside the enclave.')
+    print('* EPC paging: the additional enclave overhead on the large data set, which exceeds the EPC')
+    print('* total: edb-enclave compared to mariadbd without TLS on the large data set\n')
+    print('| workload | TLS | edgeless | ocalls | EPC paging | total |')
+    print('|---|---|---|---|---|---|')
+    for workload in WORKLOADS:
+        def get(flavour, dataset='small'):
+            return tps(flavour, dataset, workload)
+
+        tls = overhead(get('mariadbd-notls'), get('mariadbd'))
+        edgeless = overhead(get('mariadbd'), get('edb-noenclave'))
+        ocalls = overhead(get('edb-noenclave'), get('edb-enclave'))
+        paging = None
+        if None not in (get('edb-noenclave'), get('edb-enclave'), get('edb-noenclave', 'large'), get('edb-enclave', 'large')):
+            small_ratio = get('edb-enclave') / get('edb-noenclave')
+            large_ratio = get('edb-enclave', 'large') / get('edb-noenclave', 'large')
+            paging = (1 - large_ratio / small_ratio) * 100
+        total = overhead(get('mariadbd-notls', 'large'), get('edb-enclave', 'large'))
+        print(f'| {workload} | ' + ' | '.join(fmt(x) for x in (tls, edgeless, ocalls, paging, total)) + ' |')
+
+    print('\n## Host syscalls per event (edb-enclave)\n')
+    print('Syscalls that are not redirected to the store. Most of them are ocalls for host file and socket I/O.\n')
+    print('| workload | ' + ' | '.join(DATASETS) + ' |')
+    print('|---' * (len(DATASETS) + 1) + '|')
+    for workload in WORKLOADS:
+        cells = (host_syscalls_per_event(results_dir, 'edb-enclave', dataset, workload) for dataset in DATASETS)
+        print(f'| {workload} | ' + ' | '.join(fmt(x) for x in cells) + ' |')
+
+
+if __name__ == '__main__':
+    main()
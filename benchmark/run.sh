@@ -0,0 +1,136 @@
+#!/bin/bash
+# Runs the SQL benchmark suite against one server flavour and stores the sysbench output in RESULTS/FLAVOUR.
+# Usage: run.sh BUILD_DIR FLAVOUR [RESULTS]
+# FLAVOUR is one of mariadbd-notls, mariadbd, edb-noenclave, edb-enclave.
+set -e
+
+BUILD=$(readlink -f "$1")
+FLAVOUR=$2
+RESULTS=$(readlink -f "${3:-results}")/$FLAVOUR
+DIR=$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")
+
+THREADS=${THREADS:-16}
+TIME=${TIME:-60}
+TABLES=${TABLES:-4}
+# The small data set should fit into the EPC, the large one should not.
+SMALL_TABLE_SIZE=${SMALL_TABLE_SIZE:-10000}
+LARGE_TABLE_SIZE=${LARGE_TABLE_SIZE:-2000000}
+
+PORT=${PORT:-3306}
+API_PORT=${API_PORT:-8080}
+
+if [ -z "$FLAVOUR" ]; then
+  echo "usage: $0 BUILD_DIR FLAVOUR [RESULTS]"
+  exit 1
+fi
+
+WORK=$(mktemp -d)
+# servers run in their own process group so that child processes are stopped, too
+trap 'kill -- -"$SERVER_PID" 2>/dev/null; wait; rm -rf "$WORK"' EXIT
+mkdir -p "$RESULTS"
+
+# sysbench 1.0 reads the client certificates from these files in the working directory
+gencerts() {
+  cd "$WORK"
+  openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj '/CN=Bench CA' -keyout ca-key.pem -out cacert.pem 2>/dev/null
+  openssl req -newkey rsa:2048 -nodes -subj "/CN=$1" -keyout client-key.pem -out client-csr.pem 2>/dev/null
+  openssl x509 -req -days 1 -CA cacert.pem -CAkey ca-key.pem -CAcreateserial -in client-csr.pem -out client-cert.pem 2>/dev/null
+  cd - >/dev/null
+}
+
+start_mariadbd() {
+  local ssl_opts=()
+  if [ "$FLAVOUR" = mariadbd ]; then
+    gencerts localhost
+    ssl_opts=(--require-secure-transport=1 --ssl-ca="$WORK/cacert.pem" --ssl-cert="$WORK/client-cert.pem" --ssl-key="$WORK/client-key.pem")
+  fi
+  "$BUILD/mariadb/scripts/mysql_install_db" --srcdir="$BUILD/../3rdparty/edgeless-mariadb" --builddir="$BUILD/mariadb" \
+    --auth-root-authentication-method=normal --no-defaults --datadir="$WORK/data" >/dev/null
+  setsid "$BUILD/mariadbd" --no-defaults --datadir="$WORK/data" --default-storage-engine=rocksdb --port="$PORT" \
+    --socket="$WORK/mysql.sock" --skip-name-resolve "${ssl_opts[@]}" >"$RESULTS/server.log" 2>&1 &
+  SERVER_PID=$!
+  until "$BUILD/mariadb/client/mysqladmin" --socket="$WORK/mysql.sock" ping >/dev/null 2>&1; do sleep 1; done
+  "$BUILD/mariadb/client/mysql" --socket="$WORK/mysql.sock" \
+    -e "CREATE USER sbtest; CREATE DATABASE sbtest; GRANT ALL ON sbtest.* TO sbtest"
+}
+
+start_edb() {
+  local exe=$BUILD/edb-noenclave
+  [ "$FLAVOUR" = edb-enclave ] && exe=$BUILD/edb
+  export EDG_EDB_DATA_PATH=$WORK/data
+  export EDG_EDB_DATABASE_ADDR=127.0.0.1:$PORT
+  export EDG_EDB_API_ADDR=127.0.0.1:$API_PORT
+  setsid "$exe" >"$RESULTS/server.log" 2>&1 &
+  SERVER_PID=$!
+  until curl -ksf -o /dev/null "https://127.0.0.1:$API_PORT/signature"; do sleep 1; done
+
+  gencerts sbtest
+  METRICS_TOKEN=$(openssl rand -hex 16)
+  python3 - "$WORK/cacert.pem" "$METRICS_TOKEN" >"$WORK/manifest.json" <<'PY'
+import json, sys
+with open(sys.argv[1]) as f:
+    ca = f.read()
+json.dump({
+    "sql": [
+        "CREATE USER sbtest REQUIRE ISSUER '/CN=Bench CA' SUBJECT '/CN=sbtest'",
+        "CREATE DATABASE sbtest",
+        "GRANT ALL ON sbtest.* TO sbtest",
+    ],
+    "ca": ca,
+    "metrics": {"token": sys.argv[2]},
+}, sys.stdout)
+PY
+  curl -ksf --data-binary @"$WORK/manifest.json" "https://127.0.0.1:$API_PORT/manifest"
+}
+
+case $FLAVOUR in
+  mariadbd-notls | mariadbd) start_mariadbd ;;
+  edb-noenclave | edb-enclave) start_edb ;;
+  *)
+    echo "unknown flavour: $FLAVOUR"
+    exit 1
+    ;;
+esac
+
+SSL=off
+[ "$FLAVOUR" != mariadbd-notls ] && SSL=on
+
+# saves the syscall counters of EdgelessDB, from which report.py derives the ocalls per event
+save_metrics() {
+  case $FLAVOUR in
+    edb-noenclave | edb-enclave)
+      curl -ksf -H "Authorization: Bearer $METRICS_TOKEN" "https://127.0.0.1:$API_PORT/metrics" | grep '^edb_syscalls_' >"$1" || true
+      ;;
+  esac
+}
+
+bench() {
+  local dataset=$1 name=$2 size=$3
+  shift 3
+  save_metrics "$RESULTS/$dataset-$name.before.prom"
+  (cd "$WORK" && sysbench --db-driver=mysql --mysql-host=127.0.0.1 --mysql-port="$PORT" --mysql-user=sbtest \
+    --mysql-ssl=$SSL --mysql-storage-engine=rocksdb --tables="$TABLES" --table-size="$size" --threads="$THREADS" \
+    --time="$TIME" --report-interval=0 --percentile=99 "$@") >"$RESULTS/$dataset-$name.txt"
+  save_metrics "$RESULTS/$dataset-$name.after.prom"
+}
+
+for dataset in small large; do
+  size=$SMALL_TABLE_SIZE
+  [ $dataset = large ] && size=$LARGE_TABLE_SIZE
+  echo "$FLAVOUR: preparing $dataset data set"
+  bench "$dataset" prepare "$size" oltp_read_write prepare
+  for workload in point_select read_write insert range_scan ddl_storm; do
+    echo "$FLAVOUR: $dataset $workload"
+    case $workload in
+      point_select) bench $dataset $workload "$size" oltp_point_select run ;;
+      read_write) bench $dataset $workload "$size" oltp_read_write run ;;
+      insert) bench $dataset $workload "$size" oltp_insert run ;;
+      range_scan)
+        bench $dataset $workload "$size" oltp_read_only --range_size=10000 --point_selects=0 --simple_ranges=1 \
+          --sum_ranges=0 --order_ranges=0 --distinct_ranges=0 run
+        ;;
+      ddl_storm) bench $dataset $workload "$size" "$DIR/ddl_storm.lua" run ;;
+    esac
+  done
+  bench "$dataset" cleanup "$size" oltp_read_write cleanup
+done
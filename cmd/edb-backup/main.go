@@ -0,0 +1,100 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+// edb-backup computes the token for the /backup endpoint and restores backups. The backup key of the manifest is read
+// from EDB_BACKUP_KEY in hex.
+package main
+
+import (
+	"encoding/hex"
+	"encoding/json"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+
+	"github.com/edgelesssys/edgelessdb/edb/db"
+)
+
+const usage = `Usage:
+  edb-backup token
+	prints the token for the Authorization header of /backup
+  edb-backup files <backup>
+	prints the files of a backup as the body of the next /backup request
+  edb-backup restore [-data <dir>] <backup> [<previous backup>...]
+	restores a backup into the data directory, previous backups provide the files it leaves out, newest first
+`
+
+func main() {
+	if len(os.Args) < 2 {
+		fmt.Fprint(os.Stderr, usage)
+		os.Exit(2)
+	}
+	key, err := hex.DecodeString(os.Getenv("EDB_BACKUP_KEY"))
+	if err != nil || len(key) != 32 {
+		fail("EDB_BACKUP_KEY must be the 32 byte backup key of the manifest in hex")
+	}
+
+	switch os.Args[1] {
+	case "token":
+		fmt.Println(db.BackupToken(key))
+	case "files":
+		if len(os.Args) != 3 {
+			fail(usage)
+		}
+		file := open(os.Args[2])
+		defer file.Close()
+		files, err := db.BackupFiles(file, key)
+		if err != nil {
+			fail(err)
+		}
+		if err := json.NewEncoder(os.Stdout).Encode(files); err != nil {
+			fail(err)
+		}
+	case "restore":
+		flags := flag.NewFlagSet("restore", flag.ExitOnError)
+		dataPath := flags.String("data", "data", "data directory of edb")
+		flags.Parse(os.Args[2:])
+		if flags.NArg() == 0 {
+			fail(usage)
+		}
+		var backups []io.Reader
+		for _, path := range flags.Args() {
+			file := open(path)
+			defer file.Close()
+			backups = append(backups, file)
+		}
+		if err := db.RestoreBackup(filepath.Join(*dataPath, "#rocksdb"), key, backups...); err != nil {
+			fail(err)
+		}
+		fmt.Println("Backup restored. If the data directory has no sealed key, recover the master key with /recover.")
+	default:
+		fail(usage)
+	}
+}
+
+func open(path string) *os.File {
+	file, err := os.Open(path)
+	if err != nil {
+		fail(err)
+	}
+	return file
+}
+
+func fail(msg interface{}) {
+	fmt.Fprintln(os.Stderr, msg)
+	os.Exit(1)
+}
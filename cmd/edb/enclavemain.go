@@ -25,6 +25,7 @@ import (
 	"syscall"
 
 	"github.com/edgelesssys/edgelessdb/edb/core"
+	"github.com/edgelesssys/edgelessdb/edb/db"
 	"github.com/edgelesssys/edgelessdb/edb/rt"
 	"github.com/edgelesssys/ego/enclave"
 	"github.com/edgelesssys/marblerun/marble/premain"
@@ -85,6 +86,22 @@ func main() {
 		panic(err)
 	}
 
+	// mount dir of the files to import from hostfs
+	if err := os.MkdirAll(filepath.Join(hostPath(absDataPath), db.ImportDir), 0700); err != nil {
+		panic(err)
+	}
+	if err := syscall.Mount(filepath.Join(absDataPath, db.ImportDir), filepath.Join("/data", db.ImportDir), "oe_host_file_system", 0, ""); err != nil {
+		panic(err)
+	}
+
+	// mount dir of the backup checkpoint from hostfs
+	if err := os.MkdirAll(filepath.Join(hostPath(absDataPath), db.BackupDir), 0700); err != nil {
+		panic(err)
+	}
+	if err := syscall.Mount(filepath.Join(absDataPath, db.BackupDir), filepath.Join("/data", db.BackupDir), "oe_host_file_system", 0, ""); err != nil {
+		panic(err)
+	}
+
 	// Create to store sealing key
 	if !*runAsMarble {
 		if err := syscall.Mount(filepath.Join(absDataPath, core.PersistenceDir), filepath.Join("/data", core.PersistenceDir), "oe_host_file_system", 0, ""); err != nil {
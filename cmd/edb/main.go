@@ -97,3 +97,17 @@ func (runtime) GetProductSealKey() ([]byte, error) {
 func (runtime) IsEnclave() bool {
 	return false
 }
+
+// The metrics are collected by the enclave layer, which doesn't exist in non-enclave mode.
+func (runtime) GetMetrics() string {
+	return ""
+}
+
+// The heap size and the number of threads aren't limited in non-enclave mode, so MariaDB's defaults are used.
+func heapSize() uint64 {
+	return 0
+}
+
+func numTCS() int {
+	return 0
+}
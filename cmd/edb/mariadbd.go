@@ -17,8 +17,12 @@ package main
 
 /*
 #cgo LDFLAGS: -Wl,-unresolved-symbols=ignore-in-object-files
+#include <stdlib.h>
 #include <unistd.h>
 int edgeless_mysqld_main(int argc, char** argv);
+void edgeless_stop_listen_internal();
+void edgeless_prefetch_metadata(size_t num_threads);
+int edgeless_create_checkpoint(const char* dir);
 
 static void waitUntilSet(volatile int* p) {
 	do {
@@ -38,6 +42,11 @@ static void waitUntilListenInternalReady() {
 */
 import "C"
 
+import (
+	"errors"
+	"unsafe"
+)
+
 type mariadbd struct{}
 
 func (mariadbd) Main(cnfPath string) int {
@@ -52,3 +61,20 @@ func (mariadbd) WaitUntilStarted() {
 func (mariadbd) WaitUntilListenInternalReady() {
 	C.waitUntilListenInternalReady()
 }
+
+func (mariadbd) StopListenInternal() {
+	C.edgeless_stop_listen_internal()
+}
+
+func (mariadbd) PrefetchMetadata(numThreads int) {
+	C.edgeless_prefetch_metadata(C.size_t(numThreads))
+}
+
+func (mariadbd) CreateCheckpoint(dir string) error {
+	cDir := C.CString(dir)
+	defer C.free(unsafe.Pointer(cDir))
+	if C.edgeless_create_checkpoint(cDir) != 0 {
+		return errors.New("creating the checkpoint failed, see the log for details")
+	}
+	return nil
+}
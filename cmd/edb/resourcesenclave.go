@@ -0,0 +1,35 @@
+// +build enclave
+
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package main
+
+/*
+#include <stddef.h>
+size_t __oe_get_heap_size();
+size_t edgeless_get_num_tcs();
+*/
+import "C"
+
+// heapSize returns the size of the enclave heap, which is fixed at signing time.
+func heapSize() uint64 {
+	return uint64(C.__oe_get_heap_size())
+}
+
+// numTCS returns the number of thread slots of the enclave (NumTCS), which is fixed at signing time.
+func numTCS() int {
+	return int(C.edgeless_get_num_tcs())
+}
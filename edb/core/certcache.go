@@ -0,0 +1,77 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package core
+
+import (
+	"bytes"
+	"crypto/tls"
+	"sync"
+	"time"
+)
+
+// certCacheLifetime is how long an ephemeral certificate is reused. It must be shorter than the validity of the
+// certificates created by createCertificate.
+const certCacheLifetime = 30 * time.Minute
+
+// certCacheMaxEntries bounds the cache, because the server name is chosen by the client.
+const certCacheMaxEntries = 64
+
+/*
+certCache holds the TLS configs that getConfigForClient creates for each server name and local IP.
+
+Creating the config generates a key and signs a certificate inside the enclave, which is the most expensive part of a
+handshake. Reusing the config also lets clients resume their TLS sessions cheaply.
+*/
+type certCache struct {
+	mutex   sync.Mutex
+	entries map[certCacheKey]certCacheEntry
+}
+
+type certCacheKey struct {
+	hostname string
+	ip       string
+}
+
+type certCacheEntry struct {
+	config     *tls.Config
+	signerCert []byte
+	expires    time.Time
+}
+
+// get returns the cached config or calls create. The config is only reused if it has been signed by signerCert.
+func (c *certCache) get(key certCacheKey, signerCert []byte, create func() (*tls.Config, error)) (*tls.Config, error) {
+	now := time.Now()
+	c.mutex.Lock()
+	entry, ok := c.entries[key]
+	c.mutex.Unlock()
+	if ok && now.Before(entry.expires) && bytes.Equal(entry.signerCert, signerCert) {
+		return entry.config, nil
+	}
+
+	// Concurrent misses for the same key may both create a config, which is harmless.
+	config, err := create()
+	if err != nil {
+		return nil, err
+	}
+
+	c.mutex.Lock()
+	defer c.mutex.Unlock()
+	if c.entries == nil || len(c.entries) >= certCacheMaxEntries {
+		c.entries = map[certCacheKey]certCacheEntry{}
+	}
+	c.entries[key] = certCacheEntry{config, signerCert, now.Add(certCacheLifetime)}
+	return config, nil
+}
@@ -31,6 +31,7 @@ import (
 	"encoding/pem"
 	"errors"
 	"fmt"
+	"io"
 	"net"
 	"os"
 	"sync"
@@ -55,6 +56,7 @@ type Core struct {
 	report    []byte
 	isMarble  bool
 	masterKey []byte
+	certCache certCache
 }
 
 // The sequence of states EDB may be in
@@ -162,6 +164,27 @@ func (c *Core) Initialize(jsonManifest []byte) ([]byte, error) {
 	return recoveryKey, nil
 }
 
+// GetMetrics returns metrics of the enclave in the Prometheus text format.
+func (c *Core) GetMetrics() string {
+	return c.rt.GetMetrics()
+}
+
+// AuthorizeMetrics checks that token authorizes reading the metrics.
+func (c *Core) AuthorizeMetrics(token string) error {
+	return c.db.AuthorizeMetrics(token)
+}
+
+// Backup writes an encrypted online backup of the database to w if token authorizes it. SST files that are listed in
+// have are left out.
+func (c *Core) Backup(w io.Writer, token string, have []string) error {
+	return c.db.Backup(w, token, have)
+}
+
+// AuthorizeBackup checks that token authorizes backups.
+func (c *Core) AuthorizeBackup(token string) error {
+	return c.db.AuthorizeBackup(token)
+}
+
 // IsRecovering returns if edb (in standalone mode) is in recovery mode, or if it's not.
 func (c *Core) IsRecovering() bool {
 	defer c.mutex.Unlock()
@@ -187,7 +210,7 @@ func (c *Core) Recover(ctx context.Context, key []byte) error {
 func (c *Core) StartDatabase() error {
 	var dbNotInitializedYet bool
 	// Start MariaDB
-	if err := c.db.Start(); err == db.ErrNotInitializedYet {
+	if err := c.db.Start(c.masterKey); err == db.ErrNotInitializedYet {
 		dbNotInitializedYet = true
 	} else if err != nil {
 		return err
@@ -270,23 +293,27 @@ func (c *Core) getConfigForClient(chi *tls.ClientHelloInfo) (*tls.Config, error)
 	}
 
 	ips := []net.IP{{127, 0, 0, 1}}
+	var localIP net.IP
 	if addr, ok := chi.Conn.LocalAddr().(*net.TCPAddr); ok {
-		ips = append(ips, addr.IP)
+		localIP = addr.IP
+		ips = append(ips, localIP)
 	}
 
-	cert, key, err := createCertificate(hostname, ips, signerCert, signerKey)
-	if err != nil {
-		return nil, err
-	}
+	return c.certCache.get(certCacheKey{hostname, localIP.String()}, signerCert, func() (*tls.Config, error) {
+		cert, key, err := createCertificate(hostname, ips, signerCert, signerKey)
+		if err != nil {
+			return nil, err
+		}
 
-	return &tls.Config{
-		Certificates: []tls.Certificate{
-			{
-				Certificate: [][]byte{cert, signerCert},
-				PrivateKey:  key,
+		return &tls.Config{
+			Certificates: []tls.Certificate{
+				{
+					Certificate: [][]byte{cert, signerCert},
+					PrivateKey:  key,
+				},
 			},
-		},
-	}, nil
+		}, nil
+	})
 }
 
 func (c *Core) encryptRecoveryKey(key []byte, recoveryKeyPEM string) ([]byte, error) {
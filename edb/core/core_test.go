@@ -19,6 +19,7 @@ import (
 	"crypto/rand"
 	"crypto/rsa"
 	"crypto/sha256"
+	"crypto/tls"
 	"crypto/x509"
 	"encoding/pem"
 	"strings"
@@ -87,6 +88,54 @@ func TestEncryptRecoveryKey(t *testing.T) {
 	assert.Equal(mockKey, recKey)
 }
 
+func TestTLSSessionResumption(t *testing.T) {
+	assert := assert.New(t)
+	require := require.New(t)
+
+	core, _ := newCoreWithMocks()
+	listener, err := tls.Listen("tcp", "127.0.0.1:0", core.GetTLSConfig())
+	require.NoError(err)
+	defer listener.Close()
+	go func() {
+		for {
+			conn, err := listener.Accept()
+			if err != nil {
+				return
+			}
+			// the client receives the session ticket while it is reading
+			conn.Write([]byte{0})
+			conn.Close()
+		}
+	}()
+
+	rootCert, _ := core.db.GetCertificate()
+	parsedRootCert, err := x509.ParseCertificate(rootCert)
+	require.NoError(err)
+	roots := x509.NewCertPool()
+	roots.AddCert(parsedRootCert)
+	clientConfig := &tls.Config{RootCAs: roots, ServerName: "localhost", ClientSessionCache: tls.NewLRUClientSessionCache(1)}
+
+	connect := func() tls.ConnectionState {
+		conn, err := tls.Dial("tcp", listener.Addr().String(), clientConfig)
+		require.NoError(err)
+		defer conn.Close()
+		_, err = conn.Read(make([]byte, 1))
+		require.NoError(err)
+		return conn.ConnectionState()
+	}
+
+	first := connect()
+	assert.False(first.DidResume)
+	second := connect()
+	assert.True(second.DidResume)
+
+	// the ephemeral certificate is reused
+	clientConfig.ClientSessionCache = nil
+	third := connect()
+	assert.False(third.DidResume)
+	assert.Equal(first.PeerCertificates[0].Raw, third.PeerCertificates[0].Raw)
+}
+
 func newCoreWithMocks() (*Core, string) {
 	rt := rt.RuntimeMock{}
 	db := db.DatabaseMock{}
@@ -0,0 +1,340 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"archive/tar"
+	"bytes"
+	"crypto/hmac"
+	"crypto/sha256"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"sort"
+	"strings"
+	"sync/atomic"
+)
+
+// ErrBackupNotConfigured is returned by Backup if the manifest has no backup key.
+var ErrBackupNotConfigured = errors.New("the manifest does not allow backups")
+
+// ErrBackupUnauthorized is returned by Backup if the token doesn't match the backup key.
+var ErrBackupUnauthorized = errors.New("invalid backup token")
+
+// ErrBackupInProgress is returned by Backup if another backup is running.
+var ErrBackupInProgress = errors.New("a backup is already in progress")
+
+// backupConfig is the manifest's backup section.
+type backupConfig struct {
+	Key string `json:"key"` // hex-encoded 256 bit key
+}
+
+func (c *backupConfig) key() ([]byte, error) {
+	if c == nil {
+		return nil, nil
+	}
+	key, err := hex.DecodeString(c.Key)
+	if err != nil || len(key) != 32 {
+		return nil, errors.New("backup: key must be 32 bytes in hex")
+	}
+	return key, nil
+}
+
+// BackupToken returns the token that authorizes backups with key. It is the hex-encoded HMAC-SHA256 of "edb-backup",
+// so the owner of the manifest can compute it, but it doesn't reveal the key.
+func BackupToken(key []byte) string {
+	mac := hmac.New(sha256.New, key)
+	mac.Write([]byte("edb-backup"))
+	return hex.EncodeToString(mac.Sum(nil))
+}
+
+// BackupDir is the directory next to #rocksdb in which a backup creates its checkpoint. If the checkpoint can't be
+// removed, e.g., after a crash, it doesn't stay in the database directory.
+const BackupDir = "#backup"
+
+const backupCheckpointDir = "checkpoint"
+
+// backupFileList is the first entry of a backup archive. It lists all files of the checkpoint, one per line, including
+// the files that have been left out because the previous backup contains them already.
+const backupFileList = "FILES"
+
+/*
+Backup writes an online backup of the RocksDB files to w. The backup is a tar archive, encrypted with the backup key in
+the format of EncryptImport.
+
+SST files never change, so SST files that are listed in have, e.g., taken from the FILES entry of the previous backup,
+are left out. A restore combines the archive with these files.
+
+Besides the checkpoint, the archive contains the start config, so that a restored database starts with its manifest.
+
+A backup requires the BackupToken of the backup key. Only one backup runs at a time, others fail with
+ErrBackupInProgress instead of waiting.
+*/
+func (d *Mariadb) Backup(w io.Writer, token string, have []string) error {
+	if !atomic.CompareAndSwapInt32(&d.backupRunning, 0, 1) {
+		return ErrBackupInProgress
+	}
+	defer atomic.StoreInt32(&d.backupRunning, 0)
+	backupKey, err := d.authorizeBackup(token)
+	if err != nil {
+		return err
+	}
+
+	extra := map[string][]byte{}
+	startConfig, err := ioutil.ReadFile(filepath.Join(d.externalPath, "#rocksdb", filenameStartConfig))
+	if err == nil {
+		extra[filenameStartConfig] = startConfig
+	} else if !os.IsNotExist(err) {
+		return err
+	}
+
+	// remove the checkpoint of an interrupted backup
+	dir := filepath.Join(d.externalPath, BackupDir, backupCheckpointDir)
+	if err := os.RemoveAll(dir); err != nil {
+		return err
+	}
+	if err := os.MkdirAll(filepath.Dir(dir), 0700); err != nil {
+		return err
+	}
+	if err := d.mariadbd.CreateCheckpoint(dir); err != nil {
+		return err
+	}
+	defer os.RemoveAll(dir)
+
+	reader, writer := io.Pipe()
+	go func() {
+		writer.CloseWithError(writeBackupArchive(writer, dir, have, extra))
+	}()
+	err = EncryptImport(w, reader, backupKey)
+	reader.CloseWithError(err)
+	if err != nil {
+		return fmt.Errorf("backup: %v", err)
+	}
+	return nil
+}
+
+// AuthorizeBackup checks that token is the BackupToken of the backup key, so that a request can be rejected before its
+// body is read.
+func (d *Mariadb) AuthorizeBackup(token string) error {
+	_, err := d.authorizeBackup(token)
+	return err
+}
+
+func (d *Mariadb) authorizeBackup(token string) ([]byte, error) {
+	d.authMutex.Lock()
+	backupKey := d.backupKey
+	d.authMutex.Unlock()
+	if backupKey == nil {
+		return nil, ErrBackupNotConfigured
+	}
+	if !hmac.Equal([]byte(token), []byte(BackupToken(backupKey))) {
+		return nil, ErrBackupUnauthorized
+	}
+	return backupKey, nil
+}
+
+func writeBackupArchive(w io.Writer, dir string, have []string, extra map[string][]byte) error {
+	files, err := ioutil.ReadDir(dir)
+	if err != nil {
+		return err
+	}
+	skip := map[string]bool{}
+	for _, name := range have {
+		if strings.HasSuffix(name, ".sst") {
+			skip[name] = true
+		}
+	}
+
+	archive := tar.NewWriter(w)
+	var fileList strings.Builder
+	for _, file := range files {
+		fileList.WriteString(file.Name() + "\n")
+	}
+	if err := writeBackupEntry(archive, backupFileList, int64(fileList.Len()), strings.NewReader(fileList.String())); err != nil {
+		return err
+	}
+
+	var extraNames []string
+	for name := range extra {
+		extraNames = append(extraNames, name)
+	}
+	sort.Strings(extraNames)
+	for _, name := range extraNames {
+		if err := writeBackupEntry(archive, name, int64(len(extra[name])), bytes.NewReader(extra[name])); err != nil {
+			return err
+		}
+	}
+
+	for _, file := range files {
+		if skip[file.Name()] || !file.Mode().IsRegular() {
+			continue
+		}
+		if err := copyBackupFile(archive, filepath.Join(dir, file.Name()), file.Size()); err != nil {
+			return err
+		}
+	}
+	return archive.Close()
+}
+
+func copyBackupFile(archive *tar.Writer, path string, size int64) error {
+	file, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer file.Close()
+	return writeBackupEntry(archive, filepath.Base(path), size, file)
+}
+
+func writeBackupEntry(archive *tar.Writer, name string, size int64, r io.Reader) error {
+	if err := archive.WriteHeader(&tar.Header{Name: name, Mode: 0600, Size: size}); err != nil {
+		return err
+	}
+	// files of the checkpoint don't change, so the size must match
+	_, err := io.CopyN(archive, r, size)
+	return err
+}
+
+// DecryptBackup decrypts a backup that has been encrypted with key and writes the tar archive to w.
+func DecryptBackup(w io.Writer, r io.Reader, key []byte) error {
+	reader, err := newImportReader(r, key)
+	if err != nil {
+		return err
+	}
+	_, err = io.Copy(w, reader)
+	return err
+}
+
+/*
+RestoreBackup extracts backups that have been encrypted with key into the RocksDB directory dir, which must not exist.
+backups[0] is the backup to restore, the others are previous backups, newest first, that contain the SST files it
+leaves out.
+
+The restored directory contains the start config, so the database starts with the manifest of the backup. If the data
+directory has no sealed master key, it must be recovered with the recovery key of the backed up database.
+*/
+func RestoreBackup(dir string, key []byte, backups ...io.Reader) error {
+	if len(backups) == 0 {
+		return errors.New("restore: no backup")
+	}
+	if err := os.Mkdir(dir, 0700); err != nil {
+		return fmt.Errorf("restore: %v", err)
+	}
+
+	var files []string
+	restored := map[string]bool{}
+	for i, backup := range backups {
+		err := readBackupArchive(backup, key, func(name string, content io.Reader) error {
+			if name == backupFileList {
+				if i == 0 {
+					list, err := ioutil.ReadAll(content)
+					files = strings.Fields(string(list))
+					return err
+				}
+				return nil
+			}
+			// previous backups only provide the SST files that are left out
+			if i > 0 && (restored[name] || !strings.HasSuffix(name, ".sst")) {
+				return nil
+			}
+			restored[name] = true
+			return restoreBackupFile(filepath.Join(dir, name), content)
+		})
+		if err != nil {
+			return fmt.Errorf("restore: backup %v: %v", i, err)
+		}
+		if files == nil {
+			return errors.New("restore: backup has no file list")
+		}
+		if len(missingBackupFiles(files, restored)) == 0 {
+			return nil
+		}
+	}
+	return fmt.Errorf("restore: files are missing, the previous backups are required: %v", missingBackupFiles(files, restored))
+}
+
+// BackupFiles returns the FILES entry of a backup, i.e., the files that the next backup can leave out.
+func BackupFiles(r io.Reader, key []byte) ([]string, error) {
+	var files []string
+	errDone := errors.New("done")
+	err := readBackupArchive(r, key, func(name string, content io.Reader) error {
+		if name != backupFileList {
+			return errors.New("backup doesn't start with the file list")
+		}
+		list, err := ioutil.ReadAll(content)
+		if err != nil {
+			return err
+		}
+		files = strings.Fields(string(list))
+		return errDone
+	})
+	if err != errDone {
+		return nil, fmt.Errorf("backup: %v", err)
+	}
+	return files, nil
+}
+
+// readBackupArchive decrypts a backup and calls fn for each file of the archive.
+func readBackupArchive(r io.Reader, key []byte, fn func(name string, content io.Reader) error) error {
+	reader, err := newImportReader(r, key)
+	if err != nil {
+		return err
+	}
+	archive := tar.NewReader(reader)
+	for {
+		header, err := archive.Next()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return err
+		}
+		if header.Typeflag != tar.TypeReg || header.Name != filepath.Base(header.Name) || strings.HasPrefix(header.Name, ".") {
+			return fmt.Errorf("invalid file in backup: %v", header.Name)
+		}
+		if err := fn(header.Name, archive); err != nil {
+			return err
+		}
+	}
+	// the end of the archive is only authentic if the last chunk is
+	_, err = io.Copy(ioutil.Discard, reader)
+	return err
+}
+
+func restoreBackupFile(path string, content io.Reader) error {
+	file, err := os.OpenFile(path, os.O_WRONLY|os.O_CREATE|os.O_EXCL, 0600)
+	if err != nil {
+		return err
+	}
+	if _, err := io.Copy(file, content); err != nil {
+		file.Close()
+		return err
+	}
+	return file.Close()
+}
+
+func missingBackupFiles(files []string, restored map[string]bool) []string {
+	var missing []string
+	for _, name := range files {
+		if !restored[name] {
+			missing = append(missing, name)
+		}
+	}
+	return missing
+}
@@ -0,0 +1,191 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"archive/tar"
+	"bytes"
+	"io"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+	"github.com/stretchr/testify/require"
+)
+
+type checkpointMariadbd struct {
+	files map[string]string
+}
+
+func (checkpointMariadbd) Main(cnfPath string) int         { return 0 }
+func (checkpointMariadbd) WaitUntilStarted()               {}
+func (checkpointMariadbd) WaitUntilListenInternalReady()   {}
+func (checkpointMariadbd) StopListenInternal()             {}
+func (checkpointMariadbd) PrefetchMetadata(numThreads int) {}
+
+func (m checkpointMariadbd) CreateCheckpoint(dir string) error {
+	if err := os.Mkdir(dir, 0700); err != nil {
+		return err
+	}
+	for name, content := range m.files {
+		if err := ioutil.WriteFile(filepath.Join(dir, name), []byte(content), 0600); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func TestBackup(t *testing.T) {
+	assert := assert.New(t)
+	require := require.New(t)
+
+	dataPath, err := ioutil.TempDir("", "")
+	require.NoError(err)
+	defer os.RemoveAll(dataPath)
+	require.NoError(os.Mkdir(filepath.Join(dataPath, "#rocksdb"), 0700))
+	require.NoError(ioutil.WriteFile(filepath.Join(dataPath, "#rocksdb", filenameStartConfig), []byte("config"), 0600))
+
+	mariadbd := checkpointMariadbd{map[string]string{"000010.sst": "a", "000011.sst": "bb", "MANIFEST-000005": "m", "CURRENT": "MANIFEST-000005\n"}}
+	d := &Mariadb{externalPath: dataPath, mariadbd: mariadbd}
+	assert.Equal(ErrBackupNotConfigured, d.Backup(ioutil.Discard, "", nil))
+
+	d.backupKey = bytes.Repeat([]byte{3}, 32)
+	token := BackupToken(d.backupKey)
+	assert.Equal(ErrBackupUnauthorized, d.Backup(ioutil.Discard, "", nil))
+	assert.Equal(ErrBackupUnauthorized, d.Backup(ioutil.Discard, BackupToken(bytes.Repeat([]byte{4}, 32)), nil))
+	d.backupRunning = 1
+	assert.Equal(ErrBackupInProgress, d.Backup(ioutil.Discard, token, nil))
+	d.backupRunning = 0
+
+	var encrypted bytes.Buffer
+	require.NoError(d.Backup(&encrypted, token, []string{"000010.sst", "MANIFEST-000005"}))
+
+	// the checkpoint has been removed
+	_, err = os.Stat(filepath.Join(dataPath, BackupDir, backupCheckpointDir))
+	assert.True(os.IsNotExist(err))
+	files, err := ioutil.ReadDir(filepath.Join(dataPath, "#rocksdb"))
+	require.NoError(err)
+	assert.Len(files, 1)
+
+	var archive bytes.Buffer
+	require.NoError(DecryptBackup(&archive, &encrypted, d.backupKey))
+	entries := map[string]string{}
+	var names []string
+	reader := tar.NewReader(&archive)
+	for {
+		header, err := reader.Next()
+		if err == io.EOF {
+			break
+		}
+		require.NoError(err)
+		content, err := ioutil.ReadAll(reader)
+		require.NoError(err)
+		names = append(names, header.Name)
+		entries[header.Name] = string(content)
+	}
+
+	// the file list comes first and lists all files, but SST files of the previous backup are left out
+	assert.Equal(backupFileList, names[0])
+	assert.Equal("000010.sst\n000011.sst\nCURRENT\nMANIFEST-000005\n", entries[backupFileList])
+	assert.Equal(map[string]string{backupFileList: entries[backupFileList], filenameStartConfig: "config", "000011.sst": "bb", "CURRENT": "MANIFEST-000005\n", "MANIFEST-000005": "m"}, entries)
+
+	// another key can't decrypt the backup
+	encrypted.Reset()
+	require.NoError(d.Backup(&encrypted, token, nil))
+	assert.Error(DecryptBackup(ioutil.Discard, &encrypted, bytes.Repeat([]byte{4}, 32)))
+}
+
+func TestRestoreBackup(t *testing.T) {
+	assert := assert.New(t)
+	require := require.New(t)
+
+	dataPath, err := ioutil.TempDir("", "")
+	require.NoError(err)
+	defer os.RemoveAll(dataPath)
+	require.NoError(os.Mkdir(filepath.Join(dataPath, "#rocksdb"), 0700))
+	require.NoError(ioutil.WriteFile(filepath.Join(dataPath, "#rocksdb", filenameStartConfig), []byte("config"), 0600))
+
+	key := bytes.Repeat([]byte{3}, 32)
+	d := &Mariadb{externalPath: dataPath, backupKey: key}
+	backup := func(files map[string]string, have []string) []byte {
+		d.mariadbd = checkpointMariadbd{files}
+		var encrypted bytes.Buffer
+		require.NoError(d.Backup(&encrypted, BackupToken(key), have))
+		return encrypted.Bytes()
+	}
+	first := backup(map[string]string{"000010.sst": "a", "MANIFEST-000005": "m1", "CURRENT": "MANIFEST-000005\n"}, nil)
+	have, err := BackupFiles(bytes.NewReader(first), key)
+	require.NoError(err)
+	assert.Equal([]string{"000010.sst", "CURRENT", "MANIFEST-000005"}, have)
+	second := backup(map[string]string{"000010.sst": "a", "000011.sst": "b", "MANIFEST-000006": "m2", "CURRENT": "MANIFEST-000006\n"}, have)
+
+	restore := func(backups ...[]byte) (map[string]string, error) {
+		dir := filepath.Join(dataPath, "restored")
+		defer os.RemoveAll(dir)
+		var readers []io.Reader
+		for _, backup := range backups {
+			readers = append(readers, bytes.NewReader(backup))
+		}
+		if err := RestoreBackup(dir, key, readers...); err != nil {
+			return nil, err
+		}
+		files, err := ioutil.ReadDir(dir)
+		require.NoError(err)
+		result := map[string]string{}
+		for _, file := range files {
+			content, err := ioutil.ReadFile(filepath.Join(dir, file.Name()))
+			require.NoError(err)
+			result[file.Name()] = string(content)
+		}
+		return result, nil
+	}
+
+	// the SST file that the second backup leaves out is taken from the first, but its other files are not
+	files, err := restore(second, first)
+	require.NoError(err)
+	assert.Equal(map[string]string{"000010.sst": "a", "000011.sst": "b", "MANIFEST-000006": "m2", "CURRENT": "MANIFEST-000006\n", filenameStartConfig: "config"}, files)
+
+	_, err = restore(second)
+	assert.Error(err)
+	_, err = restore()
+	assert.Error(err)
+
+	// truncated backups are detected
+	_, err = restore(first[:len(first)-1])
+	assert.Error(err)
+
+	// an existing directory isn't overwritten
+	assert.Error(RestoreBackup(filepath.Join(dataPath, "#rocksdb"), key, bytes.NewReader(first)))
+}
+
+func TestBackupConfigKey(t *testing.T) {
+	assert := assert.New(t)
+
+	var config *backupConfig
+	key, err := config.key()
+	assert.NoError(err)
+	assert.Nil(key)
+
+	key, err = (&backupConfig{strings.Repeat("ab", 32)}).key()
+	assert.NoError(err)
+	assert.Equal(bytes.Repeat([]byte{0xab}, 32), key)
+
+	_, err = (&backupConfig{"abcd"}).key()
+	assert.Error(err)
+}
@@ -0,0 +1,283 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"context"
+	"crypto/aes"
+	"crypto/cipher"
+	"database/sql"
+	"encoding/binary"
+	"encoding/hex"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"path/filepath"
+	"regexp"
+	"strings"
+
+	"github.com/edgelesssys/edgelessdb/edb/rt"
+	"github.com/go-sql-driver/mysql"
+)
+
+// ImportDir is the directory next to #rocksdb from which the files of the manifest's import section are read.
+const ImportDir = "#import"
+
+/*
+importConfig is an entry of the manifest's import section. On the first start after initialization, the file is loaded
+into the table with LOAD DATA in MyRocks' bulk load mode, which writes sorted SST files directly instead of
+inserting row by row through the WAL. The table should be empty.
+
+The file is in LOAD DATA's default format (tab-separated fields, one row per line) and encrypted with EncryptImport
+under key. The key is only known to the manifest owner and the enclave, so the host can neither read nor modify the
+data. Each import must have its own key, otherwise the host could swap the files of two imports.
+*/
+type importConfig struct {
+	Table string `json:"table"` // db.table
+	File  string `json:"file"`  // file name in ImportDir
+	Key   string `json:"key"`   // hex-encoded 256 bit key
+}
+
+var importTableRegexp = regexp.MustCompile(`^[0-9A-Za-z$_]+\.[0-9A-Za-z$_]+$`)
+
+func validateImports(imports []importConfig) error {
+	files := map[string]bool{}
+	keys := map[string]bool{}
+	for _, imp := range imports {
+		if !importTableRegexp.MatchString(imp.Table) {
+			return fmt.Errorf("import: invalid table name: %v", imp.Table)
+		}
+		if imp.File == "" || filepath.Base(imp.File) != imp.File || strings.HasPrefix(imp.File, ".") {
+			return fmt.Errorf("import: invalid file name: %v", imp.File)
+		}
+		if files[imp.File] {
+			return fmt.Errorf("import: file is used twice: %v", imp.File)
+		}
+		files[imp.File] = true
+		key, err := hex.DecodeString(imp.Key)
+		if err != nil || len(key) != 32 {
+			return fmt.Errorf("import: key of %v must be 32 bytes in hex", imp.File)
+		}
+		if keys[string(key)] {
+			return fmt.Errorf("import: key of %v is used twice", imp.File)
+		}
+		keys[string(key)] = true
+	}
+	return nil
+}
+
+func (c importConfig) quotedTable() string {
+	parts := strings.Split(c.Table, ".")
+	return "`" + parts[0] + "`.`" + parts[1] + "`"
+}
+
+// importData loads the imports that have not been loaded yet. Loaded files are recorded in $edgeless.import, so a
+// restart doesn't load them twice.
+func importData(db *sql.DB, dir string, imports []importConfig) error {
+	if len(imports) == 0 {
+		return nil
+	}
+
+	// session variables must be set on the connection that runs LOAD DATA
+	ctx := context.Background()
+	conn, err := db.Conn(ctx)
+	if err != nil {
+		return err
+	}
+	defer conn.Close()
+
+	for _, imp := range imports {
+		var count int
+		if err := conn.QueryRowContext(ctx, "SELECT COUNT(*) FROM $edgeless.import WHERE f=?", imp.File).Scan(&count); err != nil {
+			return err
+		}
+		if count > 0 {
+			continue
+		}
+
+		rt.Log.Printf("importing %v into %v ...\n", imp.File, imp.Table)
+		if err := importFile(ctx, conn, filepath.Join(dir, imp.File), imp); err != nil {
+			return fmt.Errorf("import of %v: %v", imp.File, err)
+		}
+		if _, err := conn.ExecContext(ctx, "INSERT INTO $edgeless.import VALUES (?)", imp.File); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func importFile(ctx context.Context, conn *sql.Conn, path string, imp importConfig) error {
+	key, err := hex.DecodeString(imp.Key)
+	if err != nil {
+		return err
+	}
+	file, err := os.Open(path)
+	if err != nil {
+		return err
+	}
+	defer file.Close()
+	reader, err := newImportReader(file, key)
+	if err != nil {
+		return err
+	}
+
+	const handlerName = "edb-import"
+	mysql.RegisterReaderHandler(handlerName, func() io.Reader { return reader })
+	defer mysql.DeregisterReaderHandler(handlerName)
+
+	// Rows may arrive in any order. MyRocks sorts them into SST files and ingests those when bulk load is turned off.
+	if _, err := conn.ExecContext(ctx, "SET SESSION rocksdb_bulk_load_allow_unsorted=1"); err != nil {
+		return err
+	}
+	if _, err := conn.ExecContext(ctx, "SET SESSION rocksdb_bulk_load=1"); err != nil {
+		return err
+	}
+	if _, err := conn.ExecContext(ctx, "LOAD DATA LOCAL INFILE 'Reader::"+handlerName+"' INTO TABLE "+imp.quotedTable()); err != nil {
+		conn.ExecContext(ctx, "SET SESSION rocksdb_bulk_load=0")
+		return err
+	}
+	_, err = conn.ExecContext(ctx, "SET SESSION rocksdb_bulk_load=0")
+	return err
+}
+
+// The encrypted import format is a sequence of chunks. Each chunk starts with a big-endian uint32 that holds the size
+// of its ciphertext and, in the highest bit, whether it is the last chunk. It is followed by the AES-256-GCM ciphertext
+// of up to importChunkSize bytes of plaintext. The nonce is the big-endian uint64 index of the chunk, padded with
+// zeros. The additional data is a single byte that is 1 for the last chunk and 0 otherwise, so a truncated file is
+// detected.
+const (
+	importChunkSize = 1 << 20
+	importLastChunk = 1 << 31
+)
+
+// EncryptImport encrypts the data from r for the import section of the manifest.
+func EncryptImport(w io.Writer, r io.Reader, key []byte) error {
+	aead, err := newImportAEAD(key)
+	if err != nil {
+		return err
+	}
+
+	// read one chunk ahead to know which chunk is the last one
+	plaintext := make([]byte, importChunkSize)
+	n, err := io.ReadFull(r, plaintext)
+	for index := uint64(0); ; index++ {
+		if err != nil && err != io.EOF && err != io.ErrUnexpectedEOF {
+			return err
+		}
+		chunk := append([]byte(nil), plaintext[:n]...)
+		last := err != nil
+		if !last {
+			n, err = io.ReadFull(r, plaintext)
+			last = err == io.EOF
+		}
+
+		ciphertext := aead.Seal(nil, importNonce(aead, index), chunk, importAdditionalData(last))
+		header := uint32(len(ciphertext))
+		if last {
+			header |= importLastChunk
+		}
+		if err := binary.Write(w, binary.BigEndian, header); err != nil {
+			return err
+		}
+		if _, err := w.Write(ciphertext); err != nil {
+			return err
+		}
+		if last {
+			return nil
+		}
+	}
+}
+
+// importReader decrypts the encrypted import format.
+type importReader struct {
+	r     io.Reader
+	aead  cipher.AEAD
+	index uint64
+	buf   []byte
+	done  bool
+}
+
+func newImportReader(r io.Reader, key []byte) (*importReader, error) {
+	aead, err := newImportAEAD(key)
+	if err != nil {
+		return nil, err
+	}
+	return &importReader{r: r, aead: aead}, nil
+}
+
+func (r *importReader) Read(p []byte) (int, error) {
+	for len(r.buf) == 0 {
+		if r.done {
+			return 0, io.EOF
+		}
+		if err := r.readChunk(); err != nil {
+			return 0, err
+		}
+	}
+	n := copy(p, r.buf)
+	r.buf = r.buf[n:]
+	return n, nil
+}
+
+func (r *importReader) readChunk() error {
+	var header uint32
+	if err := binary.Read(r.r, binary.BigEndian, &header); err != nil {
+		if err == io.EOF {
+			return errors.New("encrypted import is truncated")
+		}
+		return err
+	}
+	last := header&importLastChunk != 0
+	size := header &^ importLastChunk
+	if size > importChunkSize+uint32(r.aead.Overhead()) {
+		return errors.New("encrypted import has an invalid chunk size")
+	}
+	ciphertext := make([]byte, size)
+	if _, err := io.ReadFull(r.r, ciphertext); err != nil {
+		return err
+	}
+
+	plaintext, err := r.aead.Open(ciphertext[:0], importNonce(r.aead, r.index), ciphertext, importAdditionalData(last))
+	if err != nil {
+		return errors.New("encrypted import is corrupt or uses another key")
+	}
+	r.index++
+	r.buf = plaintext
+	r.done = last
+	return nil
+}
+
+func newImportAEAD(key []byte) (cipher.AEAD, error) {
+	block, err := aes.NewCipher(key)
+	if err != nil {
+		return nil, err
+	}
+	return cipher.NewGCM(block)
+}
+
+func importNonce(aead cipher.AEAD, index uint64) []byte {
+	nonce := make([]byte, aead.NonceSize())
+	binary.BigEndian.PutUint64(nonce, index)
+	return nonce
+}
+
+func importAdditionalData(last bool) []byte {
+	if last {
+		return []byte{1}
+	}
+	return []byte{0}
+}
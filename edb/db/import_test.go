@@ -0,0 +1,95 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"bytes"
+	"io/ioutil"
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestImportEncryption(t *testing.T) {
+	assert := assert.New(t)
+
+	key := bytes.Repeat([]byte{1}, 32)
+
+	for _, size := range []int{0, 100, importChunkSize, 2*importChunkSize + 5} {
+		data := bytes.Repeat([]byte("1\tfoo\n"), size/6+1)[:size]
+		var encrypted bytes.Buffer
+		assert.NoError(EncryptImport(&encrypted, bytes.NewReader(data), key))
+
+		reader, err := newImportReader(bytes.NewReader(encrypted.Bytes()), key)
+		assert.NoError(err)
+		decrypted, err := ioutil.ReadAll(reader)
+		assert.NoError(err)
+		assert.Equal(data, decrypted)
+	}
+
+	data := bytes.Repeat([]byte("x"), importChunkSize+1)
+	var encrypted bytes.Buffer
+	assert.NoError(EncryptImport(&encrypted, bytes.NewReader(data), key))
+
+	// wrong key
+	reader, err := newImportReader(bytes.NewReader(encrypted.Bytes()), bytes.Repeat([]byte{2}, 32))
+	assert.NoError(err)
+	_, err = ioutil.ReadAll(reader)
+	assert.Error(err)
+
+	// modified
+	modified := append([]byte(nil), encrypted.Bytes()...)
+	modified[10] ^= 1
+	reader, err = newImportReader(bytes.NewReader(modified), key)
+	assert.NoError(err)
+	_, err = ioutil.ReadAll(reader)
+	assert.Error(err)
+
+	// truncated after the first chunk
+	firstChunk := 4 + importChunkSize + 16
+	reader, err = newImportReader(bytes.NewReader(encrypted.Bytes()[:firstChunk]), key)
+	assert.NoError(err)
+	_, err = ioutil.ReadAll(reader)
+	assert.Error(err)
+
+	// first chunk marked as last
+	marked := append([]byte(nil), encrypted.Bytes()[:firstChunk]...)
+	marked[0] |= 0x80
+	reader, err = newImportReader(bytes.NewReader(marked), key)
+	assert.NoError(err)
+	_, err = ioutil.ReadAll(reader)
+	assert.Error(err)
+}
+
+func TestValidateImports(t *testing.T) {
+	assert := assert.New(t)
+
+	key := strings.Repeat("ab", 32)
+	otherKey := strings.Repeat("cd", 32)
+	assert.NoError(validateImports(nil))
+	assert.NoError(validateImports([]importConfig{{"db.t1", "t1.tsv", key}, {"db.t2", "t2.tsv", otherKey}}))
+	assert.Equal("`db`.`t1`", importConfig{"db.t1", "t1.tsv", key}.quotedTable())
+
+	assert.Error(validateImports([]importConfig{{"t1", "t1.tsv", key}}))
+	assert.Error(validateImports([]importConfig{{"db.t`1", "t1.tsv", key}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", "../t1.tsv", key}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", ".", key}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", "", key}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", "t1.tsv", "abcd"}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", "t1.tsv", key}, {"db.t2", "t1.tsv", otherKey}}))
+	assert.Error(validateImports([]importConfig{{"db.t1", "t1.tsv", key}, {"db.t2", "t2.tsv", strings.ToUpper(key)}}))
+}
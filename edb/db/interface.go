@@ -15,7 +15,10 @@
 
 package db
 
-import "crypto"
+import (
+	"crypto"
+	"io"
+)
 
 // Database is a secure database that can be initialized by a manifest.
 type Database interface {
@@ -23,14 +26,29 @@ type Database interface {
 	GetCertificate() ([]byte, crypto.PrivateKey)
 	// Initialize sets up a database according to the jsonManifest.
 	Initialize(jsonManifest []byte) error
-	// Start starts the database.
-	Start() error
+	// Start starts the database. The master key must be the one that the database files are encrypted with.
+	Start(masterKey []byte) error
 	// GetManifestSignature returns the signature of the manifest that has been used to initialize the database.
 	GetManifestSignature() []byte
+	// Backup writes an encrypted online backup to w if token is the BackupToken of the backup key. SST files that are
+	// listed in have are left out.
+	Backup(w io.Writer, token string, have []string) error
+	// AuthorizeBackup returns the error that Backup would return for token if it isn't authorized.
+	AuthorizeBackup(token string) error
+	// AuthorizeMetrics checks that token authorizes reading the metrics.
+	AuthorizeMetrics(token string) error
 }
 
 type manifest struct {
-	SQL   []string
-	CA    string
-	Debug bool
+	SQL        []string
+	CA         string
+	Debug      bool
+	RocksDB    *rocksdbConfig
+	QueryCache *queryCacheConfig
+	Import     []importConfig
+	Backup     *backupConfig
+	Metrics    *metricsConfig
+
+	// Replication is rejected, see errReplicationUnsupported.
+	Replication bool
 }
@@ -31,7 +31,9 @@ import (
 	"os"
 	"path/filepath"
 	"regexp"
+	"runtime"
 	"strings"
+	"sync"
 
 	"github.com/edgelesssys/edgelessdb/edb/rt"
 	_ "github.com/go-sql-driver/mysql" // import driver used via the database/sql package
@@ -55,6 +57,11 @@ const (
 // ErrPreviousInitFailed is thrown when a previous initialization attempt failed, but another init or start is attempted.
 var ErrPreviousInitFailed = errors.New("a previous initialization attempt failed")
 
+// errReplicationUnsupported is returned for manifests that enable replication. MariaDB's binary log and relay log
+// would be stored on the host, where MariaDB only encrypts them with AES-CTR and a CRC32 checksum, so the host could
+// modify them undetected.
+var errReplicationUnsupported = errors.New("replication is not supported: the binary log would not be integrity-protected on the host")
+
 // ErrNotInitializedYet is thrown when the database has not been initialized yet
 var ErrNotInitializedYet = errors.New("database has not been initialized yet")
 
@@ -63,6 +70,9 @@ type Mariadbd interface {
 	Main(cnfPath string) int
 	WaitUntilStarted()
 	WaitUntilListenInternalReady()
+	StopListenInternal()
+	PrefetchMetadata(numThreads int)
+	CreateCheckpoint(dir string) error
 }
 
 // Mariadb is a secure database based on MariaDB.
@@ -71,16 +81,24 @@ type Mariadb struct {
 	internalAddress, externalAddress string
 	debug                            bool
 	debugLogDir                      string
+	heapSize                         uint64
+	numTCS                           int
 	mariadbd                         Mariadbd
 	cert                             []byte
 	key                              crypto.PrivateKey
 	manifestSig                      []byte
 	ca                               string
+	startConfigKey                   []byte
+	backupKey                        []byte // guarded by authMutex
+	metricsToken                     string // guarded by authMutex
+	authMutex                        sync.Mutex
+	backupRunning                    int32
 	attemptedInit                    bool
 }
 
-// NewMariadb creates a new Mariadb object.
-func NewMariadb(internalPath, externalPath, internalAddress, externalAddress, certificateDNSName, logDir string, debug bool, isMarble bool, mariadbd Mariadbd) (*Mariadb, error) {
+// NewMariadb creates a new Mariadb object. heapSize is the size of the enclave heap and numTCS is the number of its
+// thread slots, both are 0 if unlimited.
+func NewMariadb(internalPath, externalPath, internalAddress, externalAddress, certificateDNSName, logDir string, debug bool, isMarble bool, heapSize uint64, numTCS int, mariadbd Mariadbd) (*Mariadb, error) {
 	if err := os.MkdirAll(externalPath, 0700); err != nil {
 		return nil, err
 	}
@@ -91,6 +109,8 @@ func NewMariadb(internalPath, externalPath, internalAddress, externalAddress, ce
 		externalAddress: externalAddress,
 		debug:           debug,
 		debugLogDir:     logDir,
+		heapSize:        heapSize,
+		numTCS:          numTCS,
 		mariadbd:        mariadbd,
 	}
 
@@ -138,7 +158,26 @@ func (d *Mariadb) Initialize(jsonManifest []byte) error {
 		return fmt.Errorf("edb was started in debug mode but the manifest does not allow debug mode")
 	}
 
-	if err := d.configureBootstrap(man.SQL, jsonManifest); err != nil {
+	if err := man.RocksDB.validate(d.heapSize); err != nil {
+		return err
+	}
+	if err := man.QueryCache.validate(d.heapSize, man.RocksDB.withDefaults(d.heapSize)); err != nil {
+		return err
+	}
+	if err := validateImports(man.Import); err != nil {
+		return err
+	}
+	if _, err := man.Backup.key(); err != nil {
+		return err
+	}
+	if _, err := man.Metrics.token(); err != nil {
+		return err
+	}
+	if man.Replication {
+		return errReplicationUnsupported
+	}
+
+	if err := d.configureBootstrap(man.SQL, man.RocksDB.withDefaults(d.heapSize), jsonManifest); err != nil {
 		return err
 	}
 
@@ -163,8 +202,14 @@ func (d *Mariadb) Initialize(jsonManifest []byte) error {
 }
 
 // Start starts the database.
-func (d *Mariadb) Start() error {
-	_, err := os.Stat(filepath.Join(d.externalPath, "#rocksdb"))
+func (d *Mariadb) Start(masterKey []byte) error {
+	configKey, err := startConfigKey(masterKey)
+	if err != nil {
+		return err
+	}
+	d.startConfigKey = configKey
+
+	_, err = os.Stat(filepath.Join(d.externalPath, "#rocksdb"))
 	if os.IsNotExist(err) {
 		rt.Log.Println("DB has not been initialized, waiting for manifest.")
 		return ErrNotInitializedYet
@@ -173,7 +218,16 @@ func (d *Mariadb) Start() error {
 		return err
 	}
 
-	if err := d.configureStart(); err != nil {
+	// If a previous start has saved the config, MariaDB can be started right away.
+	cert, key, jsonManifest, err := d.readStartConfig()
+	if err == nil {
+		return d.fastStart(cert, key, jsonManifest)
+	}
+	if !os.IsNotExist(err) {
+		rt.Log.Println("Cannot use the saved start config:", err)
+	}
+
+	if err := d.configureStart(defaultRocksDBConfig(d.heapSize), nil); err != nil {
 		return err
 	}
 
@@ -184,52 +238,154 @@ func (d *Mariadb) Start() error {
 		return err
 	}
 
-	rt.Log.Println("starting up ...")
-	go func() {
-		ret := d.mariadbd.Main(filepath.Join(d.internalPath, filenameCnf))
-		panic(fmt.Errorf("mariadbd.Main returned unexpectedly with %v", ret))
-	}()
+	d.launchMariadbd()
 	d.mariadbd.WaitUntilListenInternalReady()
 
 	// errors are unrecoverable from here
 
-	cert, key, jsonManifest, err := getConfigFromSQL(normalizedInternalAddr)
+	// All queries during startup share one connection to the internal address.
+	db, err := sqlOpen(normalizedInternalAddr)
+	if err != nil {
+		panic(err)
+	}
+	db.SetMaxOpenConns(1)
+
+	cert, key, jsonManifest, err = getConfigFromSQL(db)
 	if err != nil {
 		rt.Log.Println("An initialization attempt failed. The DB is in an inconsistent state. Please provide an empty data directory.")
 		rt.Log.Fatalln(err)
 	}
 
-	var man manifest
-	if err := json.Unmarshal(jsonManifest, &man); err != nil {
+	man, err := d.parseManifest(jsonManifest)
+	if err != nil {
 		panic(err)
 	}
-
-	if d.debug && !man.Debug {
-		panic(fmt.Errorf("edb was started in debug mode but the manifest does not allow debug mode"))
+	if man.QueryCache != nil && man.QueryCache.SizeMB != 0 {
+		rt.Log.Println("The query cache will be enabled on the next start.")
 	}
 
-	d.setManifestSignature(jsonManifest)
-	d.ca = man.CA
-	d.cert = cert
-	d.key = key
+	// The manifest can only be read once MariaDB is running, so its RocksDB tuning is applied to the running server.
+	// configureStart has already set the defaults for the heap size.
+	if err := applyRocksDBConfig(db, man.RocksDB); err != nil {
+		panic(err)
+	}
+	if err := importData(db, filepath.Join(d.externalPath, ImportDir), man.Import); err != nil {
+		rt.Log.Fatalln(err)
+	}
+	db.Close()
 
-	if err := d.writeCertificates(); err != nil {
+	if err := d.setConfig(cert, key, jsonManifest, man); err != nil {
 		panic(err)
 	}
+	if err := d.writeStartConfig(cert, key, jsonManifest); err != nil {
+		rt.Log.Println("Failed to save the start config, the next start will be slower:", err)
+	}
 
-	// clear env var and connect once more to signal mariadb that we are ready to start
+	// clear env var and signal mariadb that we are ready to start
 	if err := os.Setenv(edbInternalAddr, ""); err != nil {
 		panic(err)
 	}
-	c, err := net.Dial("tcp", normalizedInternalAddr)
+	d.mariadbd.StopListenInternal()
+
+	d.waitUntilStarted()
+	return nil
+}
+
+// fastStart starts the database with the saved start config. The certificates are written before MariaDB is launched,
+// so it does not need to listen on the internal address first.
+func (d *Mariadb) fastStart(cert []byte, key crypto.PrivateKey, jsonManifest []byte) error {
+	man, err := d.parseManifest(jsonManifest)
 	if err != nil {
-		panic(err)
+		return err
+	}
+	if err := d.configureStart(man.RocksDB.withDefaults(d.heapSize), man.QueryCache); err != nil {
+		return err
+	}
+	if err := d.setConfig(cert, key, jsonManifest, man); err != nil {
+		return err
+	}
+	if err := os.Unsetenv(edbInternalAddr); err != nil {
+		return err
 	}
-	c.Close()
 
+	d.launchMariadbd()
+	d.waitUntilStarted()
+	return nil
+}
+
+func (d *Mariadb) waitUntilStarted() {
 	d.mariadbd.WaitUntilStarted()
 	rt.Log.Println("DB is running.")
-	return nil
+	// Load the table definitions in the background so that the first queries that open many tables, e.g., on
+	// information_schema, don't read them one by one.
+	go d.mariadbd.PrefetchMetadata(prefetchThreads(runtime.NumCPU()))
+}
+
+func (d *Mariadb) launchMariadbd() {
+	rt.Log.Println("starting up ...")
+	go func() {
+		ret := d.mariadbd.Main(filepath.Join(d.internalPath, filenameCnf))
+		panic(fmt.Errorf("mariadbd.Main returned unexpectedly with %v", ret))
+	}()
+}
+
+// parseManifest parses the manifest the database has been initialized with and checks that it can be used for this
+// instance.
+func (d *Mariadb) parseManifest(jsonManifest []byte) (manifest, error) {
+	var man manifest
+	if err := json.Unmarshal(jsonManifest, &man); err != nil {
+		return manifest{}, err
+	}
+	if d.debug && !man.Debug {
+		return manifest{}, fmt.Errorf("edb was started in debug mode but the manifest does not allow debug mode")
+	}
+	if err := man.RocksDB.validate(d.heapSize); err != nil {
+		return manifest{}, err
+	}
+	if err := man.QueryCache.validate(d.heapSize, man.RocksDB.withDefaults(d.heapSize)); err != nil {
+		return manifest{}, err
+	}
+	if man.Replication {
+		return manifest{}, errReplicationUnsupported
+	}
+	return man, nil
+}
+
+// setConfig sets the config read from the database and writes the certificates for MariaDB.
+func (d *Mariadb) setConfig(cert []byte, key crypto.PrivateKey, jsonManifest []byte, man manifest) error {
+	backupKey, err := man.Backup.key()
+	if err != nil {
+		return err
+	}
+	metricsToken, err := man.Metrics.token()
+	if err != nil {
+		return err
+	}
+	d.authMutex.Lock()
+	d.backupKey = backupKey
+	d.metricsToken = metricsToken
+	d.authMutex.Unlock()
+	d.setManifestSignature(jsonManifest)
+	d.ca = man.CA
+	d.cert = cert
+	d.key = key
+	return d.writeCertificates()
+}
+
+func (d *Mariadb) readStartConfig() (cert []byte, key crypto.PrivateKey, jsonManifest []byte, err error) {
+	data, err := ioutil.ReadFile(filepath.Join(d.externalPath, "#rocksdb", filenameStartConfig))
+	if err != nil {
+		return nil, nil, nil, err
+	}
+	return unsealStartConfig(d.startConfigKey, data)
+}
+
+func (d *Mariadb) writeStartConfig(cert []byte, key crypto.PrivateKey, jsonManifest []byte) error {
+	data, err := sealStartConfig(d.startConfigKey, cert, key, jsonManifest)
+	if err != nil {
+		return err
+	}
+	return ioutil.WriteFile(filepath.Join(d.externalPath, "#rocksdb", filenameStartConfig), data, 0600)
 }
 
 // GetManifestSignature returns the signature of the manifest that has been used to initialize the database.
@@ -243,7 +399,7 @@ func (d *Mariadb) setManifestSignature(jsonManifest []byte) {
 }
 
 // configure MariaDB for bootstrap
-func (d *Mariadb) configureBootstrap(sql []string, jsonManifest []byte) error {
+func (d *Mariadb) configureBootstrap(sql []string, rocksdb rocksdbConfig, jsonManifest []byte) error {
 	var queries string
 	if len(sql) > 0 {
 		queries = strings.Join(sql, ";\n") + ";"
@@ -263,6 +419,7 @@ FLUSH PRIVILEGES;
 CREATE DATABASE $edgeless;
 CREATE TABLE $edgeless.config (c BLOB, k BLOB, m BLOB);
 INSERT INTO $edgeless.config VALUES (%#x, %#x, %#x);
+CREATE TABLE $edgeless.import (f VARCHAR(255) PRIMARY KEY);
 `, mariadbBootstrap, queries, d.cert, key, jsonManifest)
 
 	cnf := `
@@ -279,6 +436,7 @@ init-file=` + filepath.Join(d.internalPath, filenameInit) + `
 	} else {
 		cnf += fmt.Sprintf("%v=%v\n", "rocksdb_db_log_dir", d.internalPath)
 	}
+	cnf += rocksdb.cnf()
 
 	if err := d.writeFile(filenameCnf, []byte(cnf)); err != nil {
 		return err
@@ -290,7 +448,7 @@ init-file=` + filepath.Join(d.internalPath, filenameInit) + `
 }
 
 // configure MariaDB for regular start
-func (d *Mariadb) configureStart() error {
+func (d *Mariadb) configureStart(rocksdb rocksdbConfig, queryCache *queryCacheConfig) error {
 	host, port := splitHostPort(d.externalAddress, "3306")
 
 	cnf := `
@@ -307,6 +465,8 @@ ssl-ca = "` + filepath.Join(d.internalPath, filenameCA) + `"
 ssl-cert = "` + filepath.Join(d.internalPath, filenameCert) + `"
 ssl-key = "` + filepath.Join(d.internalPath, filenameKey) + `"
 `
+	cnf += threadPoolCnf(d.numTCS, runtime.NumCPU())
+
 	if d.debug {
 		// If nothing is specified ONLY error-log is printed on stderr
 		// Setting any of the logs without a file logs them to default files
@@ -334,6 +494,8 @@ binlog-format=ROW
 		cnf += fmt.Sprintf("%v=%v\n", "log_error", filepath.Join(d.internalPath, FilenameErrorLog))
 		cnf += fmt.Sprintf("%v=%v\n", "rocksdb_db_log_dir", d.internalPath)
 	}
+	cnf += rocksdb.cnf()
+	cnf += queryCache.cnf()
 	return d.writeFile(filenameCnf, []byte(cnf))
 }
 
@@ -372,13 +534,7 @@ func (d *Mariadb) writeFile(filename string, data []byte) error {
 	return ioutil.WriteFile(filepath.Join(d.internalPath, filename), data, 0600)
 }
 
-func getConfigFromSQL(address string) (cert []byte, key crypto.PrivateKey, config []byte, err error) {
-	db, err := sqlOpen(address)
-	if err != nil {
-		return
-	}
-	defer db.Close()
-
+func getConfigFromSQL(db *sql.DB) (cert []byte, key crypto.PrivateKey, config []byte, err error) {
 	var keyRaw []byte
 	if err := db.QueryRow("SELECT * from $edgeless.config").Scan(&cert, &keyRaw, &config); err != nil {
 		return nil, nil, nil, err
@@ -391,6 +547,19 @@ func getConfigFromSQL(address string) (cert []byte, key crypto.PrivateKey, confi
 	return
 }
 
+// applyRocksDBConfig applies the tuning from the manifest. Unset options keep their current values.
+func applyRocksDBConfig(db *sql.DB, config *rocksdbConfig) error {
+	if config == nil {
+		return nil
+	}
+	for _, query := range config.queries() {
+		if _, err := db.Exec(query); err != nil {
+			return fmt.Errorf("applying rocksdb config: %v", err)
+		}
+	}
+	return nil
+}
+
 func sqlOpen(address string) (*sql.DB, error) {
 	return sql.Open("mysql", "root@tcp("+address+")/")
 }
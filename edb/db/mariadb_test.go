@@ -0,0 +1,33 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestReplicationRejected(t *testing.T) {
+	assert := assert.New(t)
+
+	d := &Mariadb{}
+	_, err := d.parseManifest([]byte(`{"replication": true}`))
+	assert.Equal(errReplicationUnsupported, err)
+	assert.Equal(errReplicationUnsupported, d.Initialize([]byte(`{"replication": true}`)))
+	_, err = d.parseManifest([]byte(`{}`))
+	assert.NoError(err)
+}
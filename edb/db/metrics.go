@@ -0,0 +1,61 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"crypto/hmac"
+	"errors"
+)
+
+// ErrMetricsNotConfigured is returned by AuthorizeMetrics if the manifest has no metrics section.
+var ErrMetricsNotConfigured = errors.New("the manifest does not enable metrics")
+
+// ErrMetricsUnauthorized is returned by AuthorizeMetrics if the token doesn't match the manifest's metrics token.
+var ErrMetricsUnauthorized = errors.New("invalid metrics token")
+
+// minMetricsTokenLength keeps the token from being guessed.
+const minMetricsTokenLength = 16
+
+// metricsConfig is the manifest's metrics section. The metrics, e.g., the counts and latencies of the store operations,
+// can reveal the access pattern of the database, so /metrics is only served if the manifest enables it, and only to
+// requests that carry the token.
+type metricsConfig struct {
+	Token string `json:"token"`
+}
+
+func (c *metricsConfig) token() (string, error) {
+	if c == nil {
+		return "", nil
+	}
+	if len(c.Token) < minMetricsTokenLength {
+		return "", errors.New("metrics: token must have at least 16 characters")
+	}
+	return c.Token, nil
+}
+
+// AuthorizeMetrics checks that token is the manifest's metrics token.
+func (d *Mariadb) AuthorizeMetrics(token string) error {
+	d.authMutex.Lock()
+	metricsToken := d.metricsToken
+	d.authMutex.Unlock()
+	if metricsToken == "" {
+		return ErrMetricsNotConfigured
+	}
+	if !hmac.Equal([]byte(token), []byte(metricsToken)) {
+		return ErrMetricsUnauthorized
+	}
+	return nil
+}
@@ -0,0 +1,40 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"strings"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestAuthorizeMetrics(t *testing.T) {
+	assert := assert.New(t)
+
+	d := &Mariadb{}
+	assert.Equal(ErrMetricsNotConfigured, d.AuthorizeMetrics(""))
+
+	_, err := (&metricsConfig{Token: "short"}).token()
+	assert.Error(err)
+
+	token := strings.Repeat("t", minMetricsTokenLength)
+	d.metricsToken, err = (&metricsConfig{Token: token}).token()
+	assert.NoError(err)
+	assert.NoError(d.AuthorizeMetrics(token))
+	assert.Equal(ErrMetricsUnauthorized, d.AuthorizeMetrics(""))
+	assert.Equal(ErrMetricsUnauthorized, d.AuthorizeMetrics(token+"x"))
+}
@@ -18,15 +18,21 @@ package db
 import (
 	"crypto"
 	"encoding/json"
+	"io"
 )
 
 // DatabaseMock is a Database mock.
 type DatabaseMock struct {
-	Man manifest
+	Man  manifest
+	cert []byte
+	key  crypto.PrivateKey
 }
 
 // GetCertificate gets the database certificate.
 func (d *DatabaseMock) GetCertificate() ([]byte, crypto.PrivateKey) {
+	if d.cert != nil {
+		return d.cert, d.key
+	}
 	cert, priv, err := createCertificate("")
 
 	// The standard interface does not return an error as it just gets the certificate from the core.
@@ -34,6 +40,8 @@ func (d *DatabaseMock) GetCertificate() ([]byte, crypto.PrivateKey) {
 	if err != nil {
 		panic(err)
 	}
+	d.cert = cert
+	d.key = priv
 	return cert, priv
 }
 
@@ -46,7 +54,7 @@ func (d *DatabaseMock) Initialize(jsonManifest []byte) error {
 }
 
 // Start starts the database.
-func (d *DatabaseMock) Start() error {
+func (d *DatabaseMock) Start(masterKey []byte) error {
 	return nil
 }
 
@@ -54,3 +62,42 @@ func (d *DatabaseMock) Start() error {
 func (d *DatabaseMock) GetManifestSignature() []byte {
 	return nil
 }
+
+// Backup checks the token against the manifest's backup key and writes a fake backup to w.
+func (d *DatabaseMock) Backup(w io.Writer, token string, have []string) error {
+	if err := d.AuthorizeBackup(token); err != nil {
+		return err
+	}
+	_, err := io.WriteString(w, "backup")
+	return err
+}
+
+// AuthorizeBackup checks the token against the manifest's backup key.
+func (d *DatabaseMock) AuthorizeBackup(token string) error {
+	key, err := d.Man.Backup.key()
+	if err != nil {
+		return err
+	}
+	if key == nil {
+		return ErrBackupNotConfigured
+	}
+	if token != BackupToken(key) {
+		return ErrBackupUnauthorized
+	}
+	return nil
+}
+
+// AuthorizeMetrics checks the token against the manifest's metrics token.
+func (d *DatabaseMock) AuthorizeMetrics(token string) error {
+	metricsToken, err := d.Man.Metrics.token()
+	if err != nil {
+		return err
+	}
+	if metricsToken == "" {
+		return ErrMetricsNotConfigured
+	}
+	if token != metricsToken {
+		return ErrMetricsUnauthorized
+	}
+	return nil
+}
@@ -0,0 +1,67 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"errors"
+	"fmt"
+)
+
+// queryCacheConfig is the query cache section of the manifest. The query cache is disabled unless a size is set.
+type queryCacheConfig struct {
+	SizeMB uint64 `json:"size_mb"`
+	Mode   string `json:"mode"` // "demand" (default) caches only SELECT SQL_CACHE queries, "on" caches all cacheable queries
+}
+
+var queryCacheModes = map[string]string{
+	"":       "DEMAND",
+	"demand": "DEMAND",
+	"on":     "ON",
+}
+
+// validate checks that the config is valid and that the query cache fits into the enclave heap next to RocksDB.
+func (c *queryCacheConfig) validate(heapSize uint64, rocksdb rocksdbConfig) error {
+	if c == nil {
+		return nil
+	}
+	if _, ok := queryCacheModes[c.Mode]; !ok {
+		return fmt.Errorf("query cache: unsupported mode: %v", c.Mode)
+	}
+	if c.SizeMB == 0 && c.Mode != "" {
+		return errors.New("query cache: mode requires size_mb")
+	}
+	if c.SizeMB > maxSizeMB {
+		return errors.New("query cache: size_mb is too large")
+	}
+	if heapSize == 0 {
+		return nil
+	}
+	rocksdbMB, ok := rocksdb.memoryMB()
+	if totalMB := rocksdbMB + c.SizeMB; !ok || totalMB < rocksdbMB || totalMB > heapSize/mib/4*3 {
+		return fmt.Errorf("query cache: query cache, block cache, and write buffers need more than 3/4 of the enclave heap (%v MB)", heapSize/mib)
+	}
+	return nil
+}
+
+// cnf returns the my.cnf options for the config. The query cache can only be enabled at startup, so there are no
+// queries to apply it to a running server.
+func (c *queryCacheConfig) cnf() string {
+	if c == nil || c.SizeMB == 0 {
+		// Without this, MariaDB would still take the query cache lock for each query.
+		return "query_cache_type=OFF\n"
+	}
+	return fmt.Sprintf("query_cache_type=%v\nquery_cache_size=%v\n", queryCacheModes[c.Mode], c.SizeMB*mib)
+}
@@ -0,0 +1,52 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"encoding/json"
+	"math"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestQueryCacheConfig(t *testing.T) {
+	assert := assert.New(t)
+
+	var config *queryCacheConfig
+	assert.NoError(config.validate(1024*mib, rocksdbConfig{}))
+	assert.Equal("query_cache_type=OFF\n", config.cnf())
+
+	var man manifest
+	assert.NoError(json.Unmarshal([]byte(`{"querycache": {"size_mb": 64}}`), &man))
+	assert.Equal(&queryCacheConfig{SizeMB: 64}, man.QueryCache)
+	assert.Equal("query_cache_type=DEMAND\nquery_cache_size=67108864\n", man.QueryCache.cnf())
+	assert.Equal("query_cache_type=ON\nquery_cache_size=67108864\n", (&queryCacheConfig{SizeMB: 64, Mode: "on"}).cnf())
+
+	// the default RocksDB config uses 3/8 of the heap
+	rocksdb := man.RocksDB.withDefaults(1024 * mib)
+	assert.NoError((&queryCacheConfig{SizeMB: 384}).validate(1024*mib, rocksdb))
+	assert.Error((&queryCacheConfig{SizeMB: 385}).validate(1024*mib, rocksdb))
+	assert.NoError((&queryCacheConfig{SizeMB: 1 << 20}).validate(0, rocksdb))
+
+	// sizes that would overflow in bytes or next to RocksDB
+	assert.Error((&queryCacheConfig{SizeMB: math.MaxUint64}).validate(1024*mib, rocksdb))
+	assert.Error((&queryCacheConfig{SizeMB: math.MaxUint64}).validate(0, rocksdb))
+	assert.Error((&queryCacheConfig{SizeMB: 1}).validate(1024*mib, rocksdbConfig{BlockCacheSizeMB: math.MaxUint64}))
+
+	assert.Error((&queryCacheConfig{SizeMB: 64, Mode: "off"}).validate(1024*mib, rocksdb))
+	assert.Error((&queryCacheConfig{Mode: "on"}).validate(1024*mib, rocksdb))
+}
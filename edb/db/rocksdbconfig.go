@@ -0,0 +1,186 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"errors"
+	"fmt"
+	"math"
+	"strings"
+)
+
+const mib = 1024 * 1024
+
+// maxSizeMB is the largest size in MB that can be passed to MariaDB in bytes.
+const maxSizeMB = math.MaxUint64 / mib
+
+// rocksdbConfig is the storage engine tuning section of the manifest. Zero values are replaced by defaults.
+type rocksdbConfig struct {
+	BlockCacheSizeMB  uint64 `json:"block_cache_size_mb"`
+	WriteBufferSizeMB uint64 `json:"write_buffer_size_mb"`
+	MaxBackgroundJobs uint64 `json:"max_background_jobs"`
+	Compression       string `json:"compression"`
+
+	// Each read from a host file is an enclave transition, so compactions read their input in large chunks instead of
+	// block by block.
+	CompactionReadaheadKB uint64 `json:"compaction_readahead_kb"`
+}
+
+// maxCompactionReadaheadKB limits the buffer that each compaction holds.
+const maxCompactionReadaheadKB = 16 * 1024
+
+// RocksDB compression types supported by the build
+var rocksdbCompression = map[string]string{
+	"none": "kNoCompression",
+	"lz4":  "kLZ4Compression",
+	"zlib": "kZlibCompression",
+}
+
+// defaultRocksDBConfig derives the tuning from the enclave heap size. If the heap size is unknown (0), MariaDB's
+// defaults are used.
+func defaultRocksDBConfig(heapSize uint64) rocksdbConfig {
+	if heapSize == 0 {
+		return rocksdbConfig{}
+	}
+	heapMB := heapSize / mib
+	return rocksdbConfig{
+		BlockCacheSizeMB:      clamp(heapMB/4, 8, 4096),
+		WriteBufferSizeMB:     clamp(heapMB/32, 4, 64),
+		MaxBackgroundJobs:     2,
+		Compression:           "lz4",
+		CompactionReadaheadKB: 2048,
+	}
+}
+
+// withDefaults returns the config with unset fields taken from the defaults.
+func (c *rocksdbConfig) withDefaults(heapSize uint64) rocksdbConfig {
+	result := defaultRocksDBConfig(heapSize)
+	if c == nil {
+		return result
+	}
+	if c.BlockCacheSizeMB != 0 {
+		result.BlockCacheSizeMB = c.BlockCacheSizeMB
+	}
+	if c.WriteBufferSizeMB != 0 {
+		result.WriteBufferSizeMB = c.WriteBufferSizeMB
+	}
+	if c.MaxBackgroundJobs != 0 {
+		result.MaxBackgroundJobs = c.MaxBackgroundJobs
+	}
+	if c.Compression != "" {
+		result.Compression = c.Compression
+	}
+	if c.CompactionReadaheadKB != 0 {
+		result.CompactionReadaheadKB = c.CompactionReadaheadKB
+	}
+	return result
+}
+
+// validate checks that the config is valid and fits into the enclave heap.
+func (c *rocksdbConfig) validate(heapSize uint64) error {
+	if c == nil {
+		return nil
+	}
+	if c.MaxBackgroundJobs > 64 {
+		return errors.New("rocksdb: max_background_jobs must not exceed 64")
+	}
+	if _, ok := rocksdbCompression[c.Compression]; c.Compression != "" && !ok {
+		return fmt.Errorf("rocksdb: unsupported compression: %v", c.Compression)
+	}
+	if c.CompactionReadaheadKB > maxCompactionReadaheadKB {
+		return fmt.Errorf("rocksdb: compaction_readahead_kb must not exceed %v", maxCompactionReadaheadKB)
+	}
+	if c.BlockCacheSizeMB > maxSizeMB || c.WriteBufferSizeMB > maxSizeMB {
+		return errors.New("rocksdb: sizes are too large")
+	}
+
+	cfg := c.withDefaults(heapSize)
+	if heapSize == 0 {
+		return nil
+	}
+
+	// Leave a quarter of the heap for everything else.
+	if memoryMB, ok := cfg.memoryMB(); !ok || memoryMB > heapSize/mib/4*3 {
+		return fmt.Errorf("rocksdb: block cache and write buffers need more than 3/4 of the enclave heap (%v MB)", heapSize/mib)
+	}
+	return nil
+}
+
+// memoryMB returns the memory used by the block cache and the write buffers. ok is false if the sum overflows.
+func (c rocksdbConfig) memoryMB() (memoryMB uint64, ok bool) {
+	// MyRocks keeps up to two write buffers per column family.
+	const writeBuffers = 4
+	if c.WriteBufferSizeMB > math.MaxUint64/writeBuffers {
+		return 0, false
+	}
+	memoryMB = c.BlockCacheSizeMB + writeBuffers*c.WriteBufferSizeMB
+	return memoryMB, memoryMB >= c.BlockCacheSizeMB
+}
+
+// cnf returns the my.cnf options for the config.
+func (c rocksdbConfig) cnf() string {
+	var cnf string
+	if c.BlockCacheSizeMB != 0 {
+		cnf += fmt.Sprintf("rocksdb_block_cache_size=%v\n", c.BlockCacheSizeMB*mib)
+	}
+	if c.MaxBackgroundJobs != 0 {
+		cnf += fmt.Sprintf("rocksdb_max_background_jobs=%v\n", c.MaxBackgroundJobs)
+	}
+	if c.CompactionReadaheadKB != 0 {
+		cnf += fmt.Sprintf("rocksdb_compaction_readahead_size=%v\n", c.CompactionReadaheadKB*1024)
+	}
+	if cfOptions := c.cfOptions(); cfOptions != "" {
+		cnf += "rocksdb_default_cf_options=" + cfOptions + "\n"
+	}
+	return cnf
+}
+
+// queries returns the statements that apply the config to a running server. MyRocks reads the compaction readahead
+// only when it opens the database, so the slow start keeps the default until the next start.
+func (c rocksdbConfig) queries() []string {
+	var queries []string
+	if c.BlockCacheSizeMB != 0 {
+		queries = append(queries, fmt.Sprintf("SET GLOBAL rocksdb_block_cache_size=%v", c.BlockCacheSizeMB*mib))
+	}
+	if c.MaxBackgroundJobs != 0 {
+		queries = append(queries, fmt.Sprintf("SET GLOBAL rocksdb_max_background_jobs=%v", c.MaxBackgroundJobs))
+	}
+	if cfOptions := c.cfOptions(); cfOptions != "" {
+		queries = append(queries, "SET GLOBAL rocksdb_update_cf_options='default={"+cfOptions+"}'")
+	}
+	return queries
+}
+
+func (c rocksdbConfig) cfOptions() string {
+	var options []string
+	if c.WriteBufferSizeMB != 0 {
+		options = append(options, fmt.Sprintf("write_buffer_size=%v", c.WriteBufferSizeMB*mib))
+	}
+	if c.Compression != "" {
+		options = append(options, "compression="+rocksdbCompression[c.Compression])
+	}
+	return strings.Join(options, ";")
+}
+
+func clamp(value, min, max uint64) uint64 {
+	if value < min {
+		return min
+	}
+	if value > max {
+		return max
+	}
+	return value
+}
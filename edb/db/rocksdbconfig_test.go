@@ -0,0 +1,85 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"encoding/json"
+	"math"
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestRocksDBConfigDefaults(t *testing.T) {
+	assert := assert.New(t)
+
+	// unknown heap size keeps MariaDB's defaults
+	var config *rocksdbConfig
+	assert.Equal(rocksdbConfig{}, config.withDefaults(0))
+	assert.Empty(rocksdbConfig{}.cnf())
+
+	assert.Equal(rocksdbConfig{BlockCacheSizeMB: 256, WriteBufferSizeMB: 32, MaxBackgroundJobs: 2, Compression: "lz4", CompactionReadaheadKB: 2048}, config.withDefaults(1024*mib))
+	assert.Equal(rocksdbConfig{BlockCacheSizeMB: 8, WriteBufferSizeMB: 4, MaxBackgroundJobs: 2, Compression: "lz4", CompactionReadaheadKB: 2048}, config.withDefaults(16*mib))
+	assert.Equal(uint64(64), config.withDefaults(8192*mib).WriteBufferSizeMB)
+
+	config = &rocksdbConfig{BlockCacheSizeMB: 100, Compression: "none"}
+	assert.Equal(rocksdbConfig{BlockCacheSizeMB: 100, WriteBufferSizeMB: 32, MaxBackgroundJobs: 2, Compression: "none", CompactionReadaheadKB: 2048}, config.withDefaults(1024*mib))
+}
+
+func TestRocksDBConfigValidate(t *testing.T) {
+	assert := assert.New(t)
+
+	var config *rocksdbConfig
+	assert.NoError(config.validate(1024 * mib))
+
+	assert.NoError((&rocksdbConfig{BlockCacheSizeMB: 512, WriteBufferSizeMB: 64}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{BlockCacheSizeMB: 768}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{WriteBufferSizeMB: 256}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{MaxBackgroundJobs: 65}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{Compression: "snappy"}).validate(1024 * mib))
+	assert.NoError((&rocksdbConfig{CompactionReadaheadKB: 16384}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{CompactionReadaheadKB: 16385}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{CompactionReadaheadKB: math.MaxUint64}).validate(0))
+
+	// sizes that overflow must not pass the heap check
+	assert.Error((&rocksdbConfig{BlockCacheSizeMB: 1 << 44}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{WriteBufferSizeMB: 1 << 62}).validate(1024 * mib))
+	assert.Error((&rocksdbConfig{BlockCacheSizeMB: math.MaxUint64}).validate(0))
+	_, ok := rocksdbConfig{BlockCacheSizeMB: math.MaxUint64 - 1, WriteBufferSizeMB: 1}.memoryMB()
+	assert.False(ok)
+	_, ok = rocksdbConfig{WriteBufferSizeMB: 1 << 62}.memoryMB()
+	assert.False(ok)
+
+	// the heap can't be checked in non-enclave mode
+	assert.NoError((&rocksdbConfig{BlockCacheSizeMB: 1 << 20}).validate(0))
+}
+
+func TestRocksDBConfigManifest(t *testing.T) {
+	assert := assert.New(t)
+
+	var man manifest
+	assert.NoError(json.Unmarshal([]byte(`{"rocksdb": {"block_cache_size_mb": 128, "compression": "zlib"}}`), &man))
+	assert.Equal(&rocksdbConfig{BlockCacheSizeMB: 128, Compression: "zlib"}, man.RocksDB)
+
+	assert.Equal("rocksdb_block_cache_size=134217728\nrocksdb_default_cf_options=compression=kZlibCompression\n", man.RocksDB.cnf())
+	assert.Equal([]string{
+		"SET GLOBAL rocksdb_block_cache_size=134217728",
+		"SET GLOBAL rocksdb_update_cf_options='default={compression=kZlibCompression}'",
+	}, man.RocksDB.queries())
+
+	config := man.RocksDB.withDefaults(1024 * mib)
+	assert.Equal("rocksdb_block_cache_size=134217728\nrocksdb_max_background_jobs=2\nrocksdb_compaction_readahead_size=2097152\nrocksdb_default_cf_options=write_buffer_size=33554432;compression=kZlibCompression\n", config.cnf())
+}
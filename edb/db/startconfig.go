@@ -0,0 +1,108 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"crypto"
+	"crypto/aes"
+	"crypto/cipher"
+	"crypto/hmac"
+	"crypto/rand"
+	"crypto/sha256"
+	"crypto/x509"
+	"encoding/json"
+	"errors"
+)
+
+// The start config holds the values that Start otherwise reads through SQL from $edgeless.config. It is stored next to
+// the RocksDB files so that it is deleted together with the data. It is encrypted with a key derived from the master
+// key, so the host can neither read it nor replace it with the config of another database.
+const filenameStartConfig = "edb-startconfig"
+
+const startConfigVersion = 1
+
+type startConfig struct {
+	Version  int
+	Cert     []byte
+	Key      []byte // PKCS #8
+	Manifest []byte
+}
+
+// startConfigKey derives the key of the start config from the master key.
+func startConfigKey(masterKey []byte) ([]byte, error) {
+	if len(masterKey) == 0 {
+		return nil, errors.New("master key not set")
+	}
+	mac := hmac.New(sha256.New, masterKey)
+	mac.Write([]byte(filenameStartConfig))
+	return mac.Sum(nil), nil
+}
+
+func sealStartConfig(key []byte, cert []byte, privKey crypto.PrivateKey, jsonManifest []byte) ([]byte, error) {
+	rawKey, err := x509.MarshalPKCS8PrivateKey(privKey)
+	if err != nil {
+		return nil, err
+	}
+	plaintext, err := json.Marshal(startConfig{startConfigVersion, cert, rawKey, jsonManifest})
+	if err != nil {
+		return nil, err
+	}
+
+	aead, err := newStartConfigAEAD(key)
+	if err != nil {
+		return nil, err
+	}
+	nonce := make([]byte, aead.NonceSize())
+	if _, err := rand.Read(nonce); err != nil {
+		return nil, err
+	}
+	return aead.Seal(nonce, nonce, plaintext, nil), nil
+}
+
+func unsealStartConfig(key []byte, data []byte) (cert []byte, privKey crypto.PrivateKey, jsonManifest []byte, err error) {
+	aead, err := newStartConfigAEAD(key)
+	if err != nil {
+		return nil, nil, nil, err
+	}
+	if len(data) < aead.NonceSize() {
+		return nil, nil, nil, errors.New("start config is too short")
+	}
+	plaintext, err := aead.Open(nil, data[:aead.NonceSize()], data[aead.NonceSize():], nil)
+	if err != nil {
+		return nil, nil, nil, err
+	}
+
+	var config startConfig
+	if err := json.Unmarshal(plaintext, &config); err != nil {
+		return nil, nil, nil, err
+	}
+	if config.Version != startConfigVersion {
+		return nil, nil, nil, errors.New("unsupported start config version")
+	}
+	privKey, err = x509.ParsePKCS8PrivateKey(config.Key)
+	if err != nil {
+		return nil, nil, nil, err
+	}
+	return config.Cert, privKey, config.Manifest, nil
+}
+
+func newStartConfigAEAD(key []byte) (cipher.AEAD, error) {
+	block, err := aes.NewCipher(key)
+	if err != nil {
+		return nil, err
+	}
+	return cipher.NewGCM(block)
+}
@@ -0,0 +1,59 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestStartConfig(t *testing.T) {
+	assert := assert.New(t)
+
+	_, err := startConfigKey(nil)
+	assert.Error(err)
+
+	key, err := startConfigKey([]byte("0123456789abcdef"))
+	assert.NoError(err)
+
+	cert, privKey, err := createCertificate("localhost")
+	assert.NoError(err)
+	jsonManifest := []byte(`{"sql":["CREATE USER root"]}`)
+
+	data, err := sealStartConfig(key, cert, privKey, jsonManifest)
+	assert.NoError(err)
+
+	unsealedCert, unsealedKey, unsealedManifest, err := unsealStartConfig(key, data)
+	assert.NoError(err)
+	assert.Equal(cert, unsealedCert)
+	assert.Equal(privKey, unsealedKey)
+	assert.Equal(jsonManifest, unsealedManifest)
+
+	// another master key
+	otherKey, err := startConfigKey([]byte("fedcba9876543210"))
+	assert.NoError(err)
+	_, _, _, err = unsealStartConfig(otherKey, data)
+	assert.Error(err)
+
+	// modified data
+	data[len(data)-1] ^= 1
+	_, _, _, err = unsealStartConfig(key, data)
+	assert.Error(err)
+
+	_, _, _, err = unsealStartConfig(key, data[:4])
+	assert.Error(err)
+}
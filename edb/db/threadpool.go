@@ -0,0 +1,61 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import "fmt"
+
+// Threads that run in the enclave besides the thread pool: the Go runtime, RocksDB background jobs, and MariaDB's
+// internal threads, e.g., the signal handler, timers, and the thread pool's own timer thread. The threads that prefetch
+// the metadata cache after startup are short-lived and use these, too.
+const reservedTCS = 24
+
+// Upper bound for the threads that prefetch the metadata cache.
+const maxPrefetchThreads = 8
+
+// Lower bound for the thread pool, it would rather run out of TCS than stall all queries.
+const minPoolThreads = 8
+
+// threadPoolCnf returns the my.cnf options that let MariaDB serve connections with a thread pool that fits into the
+// enclave's thread slots instead of one thread per connection. numTCS is 0 if the number of thread slots is unlimited.
+func threadPoolCnf(numTCS, numCPU int) string {
+	if numTCS <= 0 {
+		return ""
+	}
+	maxThreads := numTCS - reservedTCS
+	if maxThreads < minPoolThreads {
+		maxThreads = minPoolThreads
+	}
+	// Each thread group needs at least one thread. Use MariaDB's default of one group per CPU if possible.
+	groups := numCPU
+	if groups > maxThreads {
+		groups = maxThreads
+	}
+	if groups < 1 {
+		groups = 1
+	}
+	return fmt.Sprintf("thread_handling=pool-of-threads\nthread_pool_size=%v\nthread_pool_max_threads=%v\n", groups, maxThreads)
+}
+
+// prefetchThreads returns the number of threads that load the .frm and db.opt files into the metadata cache.
+func prefetchThreads(numCPU int) int {
+	if numCPU > maxPrefetchThreads {
+		return maxPrefetchThreads
+	}
+	if numCPU < 1 {
+		return 1
+	}
+	return numCPU
+}
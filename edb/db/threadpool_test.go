@@ -0,0 +1,42 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+package db
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestThreadPoolCnf(t *testing.T) {
+	assert := assert.New(t)
+
+	assert.Empty(threadPoolCnf(0, 4))
+	assert.Equal("thread_handling=pool-of-threads\nthread_pool_size=4\nthread_pool_max_threads=40\n", threadPoolCnf(64, 4))
+	assert.Equal("thread_handling=pool-of-threads\nthread_pool_size=64\nthread_pool_max_threads=1000\n", threadPoolCnf(1024, 64))
+
+	// small enclaves and many CPUs
+	assert.Equal("thread_handling=pool-of-threads\nthread_pool_size=8\nthread_pool_max_threads=8\n", threadPoolCnf(16, 32))
+	assert.Equal("thread_handling=pool-of-threads\nthread_pool_size=1\nthread_pool_max_threads=40\n", threadPoolCnf(64, 0))
+}
+
+func TestPrefetchThreads(t *testing.T) {
+	assert := assert.New(t)
+
+	assert.Equal(1, prefetchThreads(0))
+	assert.Equal(4, prefetchThreads(4))
+	assert.Equal(maxPrefetchThreads, prefetchThreads(64))
+}
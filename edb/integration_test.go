@@ -698,6 +698,54 @@ func TestDropDatabase(t *testing.T) {
 	db.Close()
 }
 
+// The imports are loaded on the first start after initialization.
+func TestImport(t *testing.T) {
+	assert := assert.New(t)
+	require := require.New(t)
+
+	caCertPem, caKeyPem := createCertificate("ca", "", "")
+	usrCertPem, usrKeyPem := createCertificate("usr", caCertPem, caKeyPem)
+
+	key := bytes.Repeat([]byte{2}, 32)
+	manifest, err := json.Marshal(map[string]interface{}{
+		"sql": []string{
+			"CREATE USER usr REQUIRE ISSUER '/CN=ca' SUBJECT '/CN=usr'",
+			"CREATE DATABASE test",
+			"CREATE TABLE test.data (i INT PRIMARY KEY, s VARCHAR(8))",
+			"GRANT ALL ON test.* TO usr",
+		},
+		"ca":     caCertPem,
+		"import": []map[string]string{{"table": "test.data", "file": "data.enc", "key": hex.EncodeToString(key)}},
+	})
+	require.NoError(err)
+
+	setConfig(false, "")
+	defer cleanupConfig()
+
+	importDir := filepath.Join(os.Getenv(core.EnvDataPath), db.ImportDir)
+	require.NoError(os.Mkdir(importDir, 0700))
+	var data bytes.Buffer
+	require.NoError(db.EncryptImport(&data, bytes.NewBufferString("2\ttwo\n1\tone\n"), key))
+	require.NoError(ioutil.WriteFile(filepath.Join(importDir, "data.enc"), data.Bytes(), 0600))
+
+	process := startEDB("")
+	assert.NotNil(process)
+	defer process.Kill()
+
+	serverCert := getServerCertificate()
+	_, err = postManifest(serverCert, manifest, true)
+	require.NoError(err)
+
+	sqlDB := sqlOpen("usr", usrCertPem, usrKeyPem, serverCert)
+	defer sqlDB.Close()
+	var count int
+	var s string
+	require.NoError(sqlDB.QueryRow("SELECT COUNT(*) FROM test.data").Scan(&count))
+	assert.Equal(2, count)
+	require.NoError(sqlDB.QueryRow("SELECT s FROM test.data WHERE i=2").Scan(&s))
+	assert.Equal("two", s)
+}
+
 func setConfig(debug bool, logDir string) {
 	tempPath, err := ioutil.TempDir("", "")
 	if err != nil {
@@ -28,4 +28,7 @@ type Runtime interface {
 
 	// RestartHostProcess restarts the process hosting this enclave.
 	RestartHostProcess()
+
+	// GetMetrics gets metrics of the enclave in the Prometheus text format.
+	GetMetrics() string
 }
@@ -43,3 +43,8 @@ func (r RuntimeMock) GetProductSealKey() ([]byte, error) {
 // RestartHostProcess restarts the process hosting this enclave.
 func (RuntimeMock) RestartHostProcess() {
 }
+
+// GetMetrics gets metrics of the enclave in the Prometheus text format.
+func (RuntimeMock) GetMetrics() string {
+	return "edb_mock_total 1\n"
+}
@@ -24,8 +24,10 @@ import (
 	"io"
 	"io/ioutil"
 	"net/http"
+	"strings"
 
 	"github.com/edgelesssys/edgelessdb/edb/core"
+	"github.com/edgelesssys/edgelessdb/edb/db"
 	"github.com/edgelesssys/edgelessdb/edb/rt"
 )
 
@@ -78,6 +80,50 @@ func CreateServeMux(core *core.Core) *http.ServeMux {
 		writeJSON(w, certQuoteResp{cert, report})
 	})
 
+	mux.HandleFunc("/metrics", func(w http.ResponseWriter, r *http.Request) {
+		// The metrics can reveal the access pattern, so they are only served with the manifest's metrics token.
+		if err := core.AuthorizeMetrics(bearerToken(r)); err != nil {
+			status := http.StatusUnauthorized
+			if err == db.ErrMetricsNotConfigured {
+				status = http.StatusForbidden
+			}
+			http.Error(w, err.Error(), status)
+			return
+		}
+		w.Header().Set("Content-Type", "text/plain; version=0.0.4")
+		io.WriteString(w, core.GetMetrics())
+	})
+
+	mux.HandleFunc("/backup", func(w http.ResponseWriter, r *http.Request) {
+		if r.Method != http.MethodPost {
+			http.Error(w, http.StatusText(http.StatusMethodNotAllowed), http.StatusMethodNotAllowed)
+			return
+		}
+		// The token is derived from the manifest's backup key, see db.BackupToken. It is checked before the body is read.
+		token := bearerToken(r)
+		if err := core.AuthorizeBackup(token); err != nil {
+			writeBackupError(w, err)
+			return
+		}
+		// The body may contain a JSON list of the files of the previous backup, which are left out if they are SST files.
+		var have []string
+		body, err := ioutil.ReadAll(http.MaxBytesReader(w, r.Body, maxBackupRequestSize))
+		if err != nil {
+			http.Error(w, err.Error(), http.StatusBadRequest)
+			return
+		}
+		if len(body) > 0 {
+			if err := json.Unmarshal(body, &have); err != nil {
+				http.Error(w, err.Error(), http.StatusBadRequest)
+				return
+			}
+		}
+		w.Header().Set("Content-Type", "application/octet-stream")
+		if err := core.Backup(w, token, have); err != nil {
+			writeBackupError(w, err)
+		}
+	})
+
 	mux.HandleFunc("/recover", func(w http.ResponseWriter, r *http.Request) {
 		if r.Method != http.MethodPost {
 			http.Error(w, http.StatusText(http.StatusMethodNotAllowed), http.StatusMethodNotAllowed)
@@ -100,6 +146,28 @@ func CreateServeMux(core *core.Core) *http.ServeMux {
 	return mux
 }
 
+func bearerToken(r *http.Request) string {
+	return strings.TrimPrefix(r.Header.Get("Authorization"), "Bearer ")
+}
+
+// maxBackupRequestSize limits the file list in the body of a /backup request.
+const maxBackupRequestSize = 4 << 20
+
+func writeBackupError(w http.ResponseWriter, err error) {
+	switch err {
+	case db.ErrBackupNotConfigured:
+		http.Error(w, err.Error(), http.StatusForbidden)
+	case db.ErrBackupUnauthorized:
+		http.Error(w, err.Error(), http.StatusUnauthorized)
+	case db.ErrBackupInProgress:
+		http.Error(w, err.Error(), http.StatusTooManyRequests)
+	default:
+		// If the stream has already started, the client detects the error because the last chunk is missing.
+		rt.Log.Println("Backup failed:", err)
+		http.Error(w, err.Error(), http.StatusInternalServerError)
+	}
+}
+
 // RunServer runs a HTTP server serving mux.
 func RunServer(mux *http.ServeMux, address string, tlsConfig *tls.Config) {
 	server := http.Server{
@@ -21,6 +21,7 @@ import (
 	"crypto/sha256"
 	"crypto/x509"
 	"encoding/base64"
+	"encoding/hex"
 	"encoding/pem"
 	"net/http"
 	"net/http/httptest"
@@ -95,6 +96,80 @@ func TestManifestRecovery(t *testing.T) {
 	assert.Equal(sealedKey, plaintext)
 }
 
+func TestMetrics(t *testing.T) {
+	assert := assert.New(t)
+
+	token := strings.Repeat("t", 16)
+	core, _, _, _ := newCoreWithMocks()
+	defer os.Unsetenv("EROCKSDB_MASTERKEY")
+	mux := CreateServeMux(core)
+
+	// the manifest doesn't enable metrics yet
+	req := httptest.NewRequest("GET", "/metrics", nil)
+	resp := httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusForbidden, resp.Code)
+
+	req = httptest.NewRequest("POST", "/manifest", strings.NewReader(`{"metrics": {"token": "`+token+`"}}`))
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusOK, resp.Code)
+
+	req = httptest.NewRequest("GET", "/metrics", nil)
+	req.Header.Set("Authorization", "Bearer wrong")
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusUnauthorized, resp.Code)
+
+	req = httptest.NewRequest("GET", "/metrics", nil)
+	req.Header.Set("Authorization", "Bearer "+token)
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusOK, resp.Code)
+	assert.Equal("text/plain; version=0.0.4", resp.Header().Get("Content-Type"))
+	assert.Equal("edb_mock_total 1\n", resp.Body.String())
+}
+
+func TestBackup(t *testing.T) {
+	assert := assert.New(t)
+
+	key := strings.Repeat("ab", 32)
+	core, mockDB, _, _ := newCoreWithMocks()
+	defer os.Unsetenv("EROCKSDB_MASTERKEY")
+	mux := CreateServeMux(core)
+
+	// the manifest has no backup key yet
+	req := httptest.NewRequest("POST", "/backup", nil)
+	resp := httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusForbidden, resp.Code)
+
+	req = httptest.NewRequest("POST", "/manifest", strings.NewReader(`{"backup": {"key": "`+key+`"}}`))
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusOK, resp.Code)
+	assert.NotNil(mockDB.Man.Backup)
+
+	req = httptest.NewRequest("POST", "/backup", nil)
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusUnauthorized, resp.Code)
+
+	keyBytes, _ := hex.DecodeString(key)
+	req = httptest.NewRequest("POST", "/backup", strings.NewReader(`["`+strings.Repeat("x", maxBackupRequestSize)+`"]`))
+	req.Header.Set("Authorization", "Bearer "+db.BackupToken(keyBytes))
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusBadRequest, resp.Code)
+
+	req = httptest.NewRequest("POST", "/backup", nil)
+	req.Header.Set("Authorization", "Bearer "+db.BackupToken(keyBytes))
+	resp = httptest.NewRecorder()
+	mux.ServeHTTP(resp, req)
+	assert.Equal(http.StatusOK, resp.Code)
+	assert.Equal("backup", resp.Body.String())
+}
+
 func createMockRecoveryKey() (string, *rsa.PrivateKey, error) {
 	priv, err := rsa.GenerateKey(rand.Reader, 2048)
 	if err != nil {
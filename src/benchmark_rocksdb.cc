@@ -0,0 +1,74 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include "benchmark_rocksdb.h"
+
+#include <rocksdb/utilities/transaction_db.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include "rocksdb.h"
+#include "syscall_handler.h"
+
+// RocksDB expects these to be defined by mariadb/storage/rocksdb/ha_rocksdb.cc
+namespace myrocks {
+rocksdb::TransactionDB* rdb;
+static std::vector<rocksdb::ColumnFamilyHandle*> cf_handles;
+
+rocksdb::ColumnFamilyHandle* edgeless_get_column_family(const std::string& name) {
+  for (const auto cf : cf_handles)
+    if (cf->GetName() == name)
+      return cf;
+  return nullptr;
+}
+}  // namespace myrocks
+
+using namespace std;
+using namespace edb;
+
+StorePtr edb::OpenBenchmarkRocksDB(const std::string& path) {
+  if (myrocks::rdb)
+    throw logic_error("rocksdb: already open");
+
+  rocksdb::Options options;
+  options.create_if_missing = true;
+  options.create_missing_column_families = true;
+  options.manual_wal_flush = true;  // like MyRocks
+
+  const vector<rocksdb::ColumnFamilyDescriptor> cfs{
+      {rocksdb::kDefaultColumnFamilyName, {}},
+      {string(kCfNameFrm), {}},
+      {string(kCfNameDb), {}},
+  };
+
+  rocksdb::TransactionDB* db = nullptr;
+  const auto status = rocksdb::TransactionDB::Open(options, {}, path, cfs, &myrocks::cf_handles, &db);
+  if (!status.ok())
+    throw runtime_error("rocksdb: " + status.ToString());
+  myrocks::rdb = db;
+
+  return make_shared<RocksDB>();
+}
+
+void edb::CloseBenchmarkRocksDB() {
+  if (!myrocks::rdb)
+    return;
+  for (const auto cf : myrocks::cf_handles)
+    myrocks::rdb->DestroyColumnFamilyHandle(cf);
+  myrocks::cf_handles.clear();
+  delete myrocks::rdb;
+  myrocks::rdb = nullptr;
+}
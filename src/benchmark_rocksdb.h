@@ -0,0 +1,29 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <string>
+
+#include "store.h"
+
+namespace edb {
+
+// Opens a standalone RocksDB database at path with the column families that MyRocks would create and returns a RocksDB
+// store that uses it. This is for benchmarking the store without running MariaDB.
+StorePtr OpenBenchmarkRocksDB(const std::string& path);
+void CloseBenchmarkRocksDB();
+
+}  // namespace edb
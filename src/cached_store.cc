@@ -0,0 +1,277 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include "cached_store.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <functional>
+#include <thread>
+
+using namespace std;
+using namespace edb;
+
+// approximate memory used by an entry in addition to its key and value
+static constexpr size_t kEntryOverhead = 128;
+
+CachedStore::CachedStore(StorePtr store, size_t capacity)
+    : store_(move(store)) {
+  assert(store_);
+  SetCapacity(capacity);
+}
+
+namespace {
+class CachedValue final : public Store::PinnedValue {
+ public:
+  explicit CachedValue(shared_ptr<const string> value)
+      : value_(move(value)) {
+  }
+
+  std::string_view Data() const noexcept override {
+    return *value_;
+  }
+
+ private:
+  const shared_ptr<const string> value_;
+};
+}  // namespace
+
+std::optional<std::string> CachedStore::Get(std::string_view column_family, std::string_view key) const {
+  const auto value = GetValue(column_family, key);
+  if (!value)
+    return {};
+  return *value;
+}
+
+Store::PinnedValuePtr CachedStore::GetPinned(std::string_view column_family, std::string_view key) const {
+  auto value = GetValue(column_family, key);
+  if (!value)
+    return nullptr;
+  return make_unique<CachedValue>(move(value));
+}
+
+void CachedStore::Put(std::string_view column_family, std::string_view key, std::string_view value) {
+  store_->Put(column_family, key, value);
+  auto cached_value = make_shared<const string>(value);
+  string cache_key = CacheKey(column_family, key);
+  Shard& shard = GetShard(cache_key);
+  const lock_guard lock(shard.mutex);
+  ++shard.generation;
+  shard.Insert(move(cache_key), move(cached_value));
+}
+
+void CachedStore::Delete(std::string_view column_family, std::string_view key) {
+  store_->Delete(column_family, key);
+  string cache_key = CacheKey(column_family, key);
+  Shard& shard = GetShard(cache_key);
+  const lock_guard lock(shard.mutex);
+  ++shard.generation;
+  shard.Insert(move(cache_key), nullptr);
+}
+
+void CachedStore::Write(const WriteBatch& batch) {
+  store_->Write(batch);
+  for (const auto& op : batch.Ops()) {
+    auto value = op.value ? make_shared<const string>(*op.value) : nullptr;
+    string cache_key = CacheKey(op.column_family, op.key);
+    Shard& shard = GetShard(cache_key);
+    const lock_guard lock(shard.mutex);
+    ++shard.generation;
+    shard.Insert(move(cache_key), move(value));
+  }
+}
+
+void CachedStore::ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const {
+  store_->ForEachKey(column_family, prefix, f);
+}
+
+void CachedStore::ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const {
+  store_->ForEach(column_family, prefix, f);
+}
+
+void CachedStore::Prefetch(std::string_view column_family, const std::vector<std::string>& prefixes, size_t num_threads) {
+  if (GetStats().capacity == 0)
+    return;
+
+  atomic<size_t> next_prefix = 0;
+  atomic<bool> full = false;
+  exception_ptr error;
+  mutex error_mutex;
+
+  const auto scan = [&] {
+    try {
+      for (size_t i = next_prefix++; i < prefixes.size() && !full; i = next_prefix++)
+        if (!PrefetchPrefix(column_family, prefixes[i]))
+          full = true;
+    } catch (...) {
+      const lock_guard lock(error_mutex);
+      if (!error)
+        error = current_exception();
+      full = true;
+    }
+  };
+
+  // the calling thread scans, too
+  vector<thread> threads;
+  for (size_t i = 1; i < min(num_threads, prefixes.size()); ++i)
+    threads.emplace_back(scan);
+  scan();
+  for (auto& t : threads)
+    t.join();
+
+  if (error)
+    rethrow_exception(error);
+}
+
+bool CachedStore::PrefetchPrefix(std::string_view column_family, std::string_view prefix) {
+  // Like in GetValue, a value that has been read from the store is only inserted if no write happened in the meantime.
+  array<uint64_t, kNumShards> generations;
+  for (size_t i = 0; i < kNumShards; ++i) {
+    const lock_guard lock(shards_[i].mutex);
+    generations[i] = shards_[i].generation;
+  }
+
+  bool full = false;
+  store_->ForEach(column_family, prefix, [&](string_view key, string_view value) {
+    string cache_key = CacheKey(column_family, key);
+    const size_t shard_index = ShardIndex(cache_key);
+    Shard& shard = shards_[shard_index];
+    const lock_guard lock(shard.mutex);
+    if (shard.generation != generations[shard_index] || shard.index.find(cache_key) != shard.index.cend())
+      return true;
+
+    // The keys are spread evenly over the shards, so if one shard is full, the others are about to be full, too.
+    if (shard.size + kEntryOverhead + cache_key.size() + value.size() > shard.capacity) {
+      full = true;
+      return false;
+    }
+    shard.Insert(move(cache_key), make_shared<const string>(value));
+    return true;
+  });
+  return !full;
+}
+
+void CachedStore::SetCapacity(size_t capacity) {
+  // The capacity is divided evenly so that the total size stays within the budget.
+  for (auto& shard : shards_) {
+    const lock_guard lock(shard.mutex);
+    shard.capacity = capacity / kNumShards;
+    shard.Evict();
+  }
+}
+
+CachedStore::Stats CachedStore::GetStats() const {
+  Stats stats{};
+  for (auto& shard : shards_) {
+    const lock_guard lock(shard.mutex);
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.size += shard.size;
+    stats.capacity += shard.capacity;
+  }
+  return stats;
+}
+
+CachedStore::Value CachedStore::GetValue(std::string_view column_family, std::string_view key) const {
+  string cache_key = CacheKey(column_family, key);
+  Shard& shard = GetShard(cache_key);
+  uint64_t generation = 0;
+
+  {
+    const lock_guard lock(shard.mutex);
+    const auto it = shard.index.find(cache_key);
+    if (it != shard.index.cend()) {
+      ++shard.hits;
+      shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+      return it->second->value;
+    }
+    ++shard.misses;
+    generation = shard.generation;
+  }
+
+  Value value;
+  if (const auto pinned = store_->GetPinned(column_family, key))
+    value = make_shared<const string>(pinned->Data());
+
+  const lock_guard lock(shard.mutex);
+  if (generation == shard.generation)
+    shard.Insert(move(cache_key), value);
+  return value;
+}
+
+void CachedStore::Shard::Insert(std::string key, Value value) {
+  const auto it = index.find(key);
+
+  // An entry that doesn't fit into the shard would evict all others before itself. It isn't cached, but an outdated
+  // value of the key must not stay in the cache.
+  if (kEntryOverhead + key.size() + (value ? value->size() : 0) > capacity) {
+    if (it != index.cend()) {
+      const auto entry = it->second;
+      size -= Charge(*entry);
+      index.erase(it);
+      lru.erase(entry);
+    }
+    return;
+  }
+
+  if (it != index.cend()) {
+    // update existing entry
+    Entry& entry = *it->second;
+    size -= Charge(entry);
+    entry.value = move(value);
+    size += Charge(entry);
+    lru.splice(lru.begin(), lru, it->second);
+  } else {
+    lru.push_front({move(key), move(value)});
+    size += Charge(lru.front());
+    index.emplace(lru.front().key, lru.begin());
+  }
+  Evict();
+}
+
+void CachedStore::Shard::Evict() {
+  while (size > capacity) {
+    assert(!lru.empty());
+    const Entry& entry = lru.back();
+    size -= Charge(entry);
+    index.erase(entry.key);
+    lru.pop_back();
+    ++evictions;
+  }
+}
+
+size_t CachedStore::ShardIndex(std::string_view cache_key) {
+  return hash<string_view>()(cache_key) % kNumShards;
+}
+
+CachedStore::Shard& CachedStore::GetShard(std::string_view cache_key) const {
+  return shards_[ShardIndex(cache_key)];
+}
+
+std::string CachedStore::CacheKey(std::string_view column_family, std::string_view key) {
+  string result;
+  result.reserve(column_family.size() + 1 + key.size());
+  result += column_family;
+  result += '\0';
+  result += key;
+  return result;
+}
+
+size_t CachedStore::Charge(const Entry& entry) {
+  return kEntryOverhead + entry.key.size() + (entry.value ? entry.value->size() : 0);
+}
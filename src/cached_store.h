@@ -0,0 +1,121 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "store.h"
+
+namespace edb {
+
+// The cache in front of the CompressedStore holds decompressed values, so the budget is in uncompressed bytes.
+constexpr size_t kDefaultMetadataCacheSize = 64 * 1024 * 1024;
+
+/*
+CachedStore is a write-through cache in front of another store.
+
+MariaDB reads the same .frm and db.opt files over and over, e.g., on each table open. CachedStore keeps recently used
+values in enclave memory, including the information that a key does not exist. Writes go to the underlying store first
+and then update the cache, so the cache never holds data that has not been persisted. ForEachKey and ForEach are not
+cached, but Prefetch can fill the cache with a scan, e.g., at startup.
+
+The cache is split into shards by key, each with its own lock and LRU list, so that concurrent lookups rarely contend.
+Callers must serialize concurrent writes to the same key; otherwise, the cache may end up with a different value
+than the store.
+*/
+class CachedStore final : public Store {
+ public:
+  struct Stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t size;
+    size_t capacity;
+  };
+
+  // capacity is the memory budget in bytes. A capacity of 0 disables caching.
+  CachedStore(StorePtr store, size_t capacity);
+
+  std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override;
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override;
+  void Put(std::string_view column_family, std::string_view key, std::string_view value) override;
+  void Delete(std::string_view column_family, std::string_view key) override;
+  void Write(const WriteBatch& batch) override;
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override;
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override;
+
+  // Loads the entries of column_family whose keys start with one of the prefixes into the cache. Up to num_threads
+  // threads scan one prefix at a time. Prefetch stops when the cache is full, so it doesn't evict entries.
+  void Prefetch(std::string_view column_family, const std::vector<std::string>& prefixes, size_t num_threads);
+
+  void SetCapacity(size_t capacity);
+  Stats GetStats() const;
+
+ private:
+  // Values are shared so that GetPinned can return them without copying.
+  typedef std::shared_ptr<const std::string> Value;
+
+  struct Entry {
+    std::string key;
+    Value value;  // nullptr means the key does not exist in the store
+  };
+  typedef std::list<Entry> List;
+
+  // Returns the cached value or reads it from the store.
+  Value GetValue(std::string_view column_family, std::string_view key) const;
+
+  struct Shard {
+    std::mutex mutex;
+
+    // Entries are ordered from most to least recently used. The index maps cache keys to list positions.
+    List lru;
+    std::unordered_map<std::string_view, List::iterator> index;
+
+    // Incremented on each write. A Get that missed the cache only inserts the value it read from the store if no write
+    // happened in the meantime, because the value may be outdated otherwise.
+    uint64_t generation = 0;
+
+    size_t size = 0;
+    size_t capacity = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // These must be called with mutex held.
+    void Insert(std::string key, Value value);
+    void Evict();
+  };
+
+  static constexpr size_t kNumShards = 16;
+
+  // Returns false if the cache is full.
+  bool PrefetchPrefix(std::string_view column_family, std::string_view prefix);
+
+  static size_t ShardIndex(std::string_view cache_key);
+  Shard& GetShard(std::string_view cache_key) const;
+  static std::string CacheKey(std::string_view column_family, std::string_view key);
+  static size_t Charge(const Entry& entry);
+
+  const StorePtr store_;
+  mutable std::array<Shard, kNumShards> shards_;
+};
+
+}  // namespace edb
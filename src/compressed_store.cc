@@ -0,0 +1,172 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include "compressed_store.h"
+
+#include <lz4.h>
+
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+using namespace edb;
+
+namespace {
+enum Format : char {
+  kFormatRaw = 0,
+  kFormatLz4 = 1,
+};
+
+constexpr size_t kRawHeaderSize = CompressedStore::kMagic.size() + 1;
+constexpr size_t kLz4HeaderSize = kRawHeaderSize + 4;
+
+class DecodedValue final : public Store::PinnedValue {
+ public:
+  explicit DecodedValue(string value)
+      : value_(move(value)) {
+  }
+
+  std::string_view Data() const noexcept override {
+    return value_;
+  }
+
+ private:
+  const string value_;
+};
+
+// Points into a pinned value of the underlying store.
+class RawValue final : public Store::PinnedValue {
+ public:
+  RawValue(Store::PinnedValuePtr value, size_t offset)
+      : value_(move(value)), offset_(offset) {
+  }
+
+  std::string_view Data() const noexcept override {
+    return value_->Data().substr(offset_);
+  }
+
+ private:
+  const Store::PinnedValuePtr value_;
+  const size_t offset_;
+};
+}  // namespace
+
+static bool HasHeader(string_view data) noexcept {
+  return data.size() >= kRawHeaderSize && data.compare(0, CompressedStore::kMagic.size(), CompressedStore::kMagic) == 0;
+}
+
+CompressedStore::CompressedStore(StorePtr store)
+    : store_(move(store)) {
+  assert(store_);
+}
+
+std::optional<std::string> CompressedStore::Get(std::string_view column_family, std::string_view key) const {
+  const auto value = store_->GetPinned(column_family, key);
+  if (!value)
+    return {};
+  return Decode(value->Data());
+}
+
+Store::PinnedValuePtr CompressedStore::GetPinned(std::string_view column_family, std::string_view key) const {
+  auto value = store_->GetPinned(column_family, key);
+  if (!value)
+    return nullptr;
+  const string_view data = value->Data();
+  if (!HasHeader(data))
+    return value;
+  if (data[kMagic.size()] == kFormatRaw)
+    return make_unique<RawValue>(move(value), kRawHeaderSize);
+  return make_unique<DecodedValue>(Decode(data));
+}
+
+void CompressedStore::Put(std::string_view column_family, std::string_view key, std::string_view value) {
+  store_->Put(column_family, key, Encode(value));
+}
+
+void CompressedStore::Delete(std::string_view column_family, std::string_view key) {
+  store_->Delete(column_family, key);
+}
+
+void CompressedStore::Write(const WriteBatch& batch) {
+  WriteBatch encoded;
+  for (const auto& op : batch.Ops())
+    if (op.value)
+      encoded.Put(op.column_family, op.key, Encode(*op.value));
+    else
+      encoded.Delete(op.column_family, op.key);
+  store_->Write(encoded);
+}
+
+void CompressedStore::ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const {
+  store_->ForEachKey(column_family, prefix, f);
+}
+
+void CompressedStore::ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const {
+  store_->ForEach(column_family, prefix, [&f](string_view key, string_view data) {
+    if (!HasHeader(data))
+      return f(key, data);
+    return f(key, Decode(data));
+  });
+}
+
+std::string CompressedStore::Encode(std::string_view value) {
+  if (kMinCompressSize <= value.size() && value.size() <= LZ4_MAX_INPUT_SIZE) {
+    const int bound = LZ4_compressBound(static_cast<int>(value.size()));
+    string result(kLz4HeaderSize + bound, '\0');
+    const int size = LZ4_compress_default(value.data(), result.data() + kLz4HeaderSize, static_cast<int>(value.size()), bound);
+    if (size > 0 && kLz4HeaderSize + size < value.size()) {
+      result.replace(0, kMagic.size(), kMagic);
+      result[kMagic.size()] = kFormatLz4;
+      for (size_t i = 0; i < 4; ++i)
+        result[kRawHeaderSize + i] = static_cast<char>(value.size() >> (8 * i));
+      result.resize(kLz4HeaderSize + size);
+      return result;
+    }
+  }
+
+  if (value.compare(0, kMagic.size(), kMagic) != 0)
+    return string(value);
+  string result(kMagic);
+  result += kFormatRaw;
+  result += value;
+  return result;
+}
+
+std::string CompressedStore::Decode(std::string_view data) {
+  if (!HasHeader(data))
+    return string(data);
+
+  switch (data[kMagic.size()]) {
+    case kFormatRaw:
+      return string(data.substr(kRawHeaderSize));
+    case kFormatLz4: {
+      if (data.size() < kLz4HeaderSize)
+        throw runtime_error("compressed store: invalid value");
+      uint32_t size = 0;
+      for (size_t i = 0; i < 4; ++i)
+        size |= static_cast<uint32_t>(static_cast<unsigned char>(data[kRawHeaderSize + i])) << (8 * i);
+      if (size > LZ4_MAX_INPUT_SIZE)
+        throw runtime_error("compressed store: invalid value");
+      string result(size, '\0');
+      const int res = LZ4_decompress_safe(data.data() + kLz4HeaderSize, result.data(), static_cast<int>(data.size() - kLz4HeaderSize), static_cast<int>(size));
+      if (res < 0 || static_cast<uint32_t>(res) != size)
+        throw runtime_error("compressed store: invalid value");
+      return result;
+    }
+    default:
+      throw runtime_error("compressed store: unsupported format version");
+  }
+}
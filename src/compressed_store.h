@@ -0,0 +1,60 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <cstddef>
+
+#include "store.h"
+
+namespace edb {
+
+/*
+CompressedStore compresses the values written to another store with lz4.
+
+.frm files of wide tables are large and compress well. Compressing them below the cache saves host I/O and the memory
+that RocksDB uses for them in the enclave, e.g., in the memtables and the block cache. The CachedStore above keeps
+decompressed values, so a cache hit is served without copying or decompressing, at the cost of fewer cached files per
+byte of budget.
+
+A compressed value starts with a header: kMagic, a format version byte, and the uncompressed size as 4 bytes in little
+endian, followed by the lz4 block. Values that are small or don't compress are stored as they are. Values without the
+header are returned unchanged, so data written before compression was added can still be read. A value that would be
+mistaken for a header is stored with the raw format version.
+*/
+class CompressedStore final : public Store {
+ public:
+  explicit CompressedStore(StorePtr store);
+
+  std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override;
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override;
+  void Put(std::string_view column_family, std::string_view key, std::string_view value) override;
+  void Delete(std::string_view column_family, std::string_view key) override;
+  void Write(const WriteBatch& batch) override;
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override;
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override;
+
+  static constexpr std::string_view kMagic{"\0EZ", 3};
+  // Values shorter than this are not compressed.
+  static constexpr size_t kMinCompressSize = 256;
+
+  static std::string Encode(std::string_view value);
+  static std::string Decode(std::string_view data);
+
+ private:
+  const StorePtr store_;
+};
+
+}  // namespace edb
@@ -18,19 +18,27 @@
 #include <sys/stat.h>
 
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <string>
 #include <thread>
 
 using namespace std;
 using namespace ert;
 
 static constexpr auto kMemfsName = "edg_memfs";
+static constexpr auto kEnvMetadataCacheSize = "EDG_EDB_METADATA_CACHE_SIZE";
+static constexpr auto kEnvTempSpillDir = "EDG_EDB_TEMP_SPILL_DIR";
+static constexpr auto kEnvTempSpillThreshold = "EDG_EDB_TEMP_SPILL_THRESHOLD";
+static constexpr size_t kDefaultTempSpillThreshold = 128;  // MB
 
 extern "C" void invokemain();
 extern "C" oe_result_t edgeless_syscall_hook();
 extern "C" void oe_register_syscall_hook(oe_result_t());
+extern "C" void edgeless_set_metadata_cache_size(size_t size);
+extern "C" void edgeless_set_temp_spill(const char* dir, size_t threshold);
 
 static int _init = [] {
 #ifndef NDEBUG
@@ -84,6 +92,31 @@ int emain() {
     return EXIT_FAILURE;
   }
 
+  // Optionally override the memory budget of the .frm/db.opt cache (in MB)
+  if (const char* cache_size = getenv(kEnvMetadataCacheSize); cache_size && *cache_size) {
+    char* end = nullptr;
+    const unsigned long long size = strtoull(cache_size, &end, 10);
+    if (*end || size > SIZE_MAX >> 20) {
+      cout << "invalid value for " << kEnvMetadataCacheSize << ": " << cache_size << endl;
+      return EXIT_FAILURE;
+    }
+    edgeless_set_metadata_cache_size(size * 1024 * 1024);
+  }
+
+  // Optionally let temp files that exceed the threshold (in MB) spill to an encrypted file in a host directory
+  if (const char* spill_dir = getenv(kEnvTempSpillDir); spill_dir && *spill_dir) {
+    unsigned long long threshold = kDefaultTempSpillThreshold;
+    if (const char* value = getenv(kEnvTempSpillThreshold); value && *value) {
+      char* end = nullptr;
+      threshold = strtoull(value, &end, 10);
+      if (*end || threshold > SIZE_MAX >> 20) {
+        cout << "invalid value for " << kEnvTempSpillThreshold << ": " << value << endl;
+        return EXIT_FAILURE;
+      }
+    }
+    edgeless_set_temp_spill(("/edg/hostfs"s + spill_dir).c_str(), threshold * 1024 * 1024);
+  }
+
   oe_register_syscall_hook(edgeless_syscall_hook);
 
   invokemain();
@@ -0,0 +1,106 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include "metrics.h"
+
+#include <string>
+
+using namespace std;
+using namespace edb;
+using namespace edb::metrics;
+
+namespace edb {
+namespace metrics {
+CounterArray<kMaxSyscall> syscalls_intercepted;
+CounterArray<kMaxSyscall> syscalls_handled;
+Counter files_opened;
+Histogram store_get_latency;
+Histogram store_put_latency;
+Histogram store_delete_latency;
+Histogram store_write_latency;
+Counter wal_flush_requests;
+Counter wal_flushes;
+}  // namespace metrics
+}  // namespace edb
+
+size_t metrics::ThreadSlot() noexcept {
+  static atomic<size_t> next_slot;
+  static thread_local const size_t slot = next_slot.fetch_add(1, memory_order_relaxed) % kNumSlots;
+  return slot;
+}
+
+void Histogram::Observe(std::chrono::nanoseconds latency, uint64_t count) noexcept {
+  const uint64_t ns = latency.count() > 0 ? latency.count() : 0;
+  size_t bucket = 0;
+  while (bucket < kNumBuckets && ns > BucketBound(bucket))
+    ++bucket;
+  buckets_.Add(bucket, count);
+  sum_ns_.Add(ns * count);
+}
+
+void Histogram::Render(std::string& out, std::string_view name, std::string_view help) const {
+  const string name_str(name);
+  out += "# HELP " + name_str + ' ' + string(help) + '\n';
+  out += "# TYPE " + name_str + " histogram\n";
+
+  // Prometheus buckets are cumulative
+  uint64_t count = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    count += buckets_.Get(i);
+    out += name_str + "_bucket{le=\"" + to_string(BucketBound(i) / 1e9) + "\"} " + to_string(count) + '\n';
+  }
+  count += buckets_.Get(kNumBuckets);
+  out += name_str + "_bucket{le=\"+Inf\"} " + to_string(count) + '\n';
+  out += name_str + "_sum " + to_string(sum_ns_.Get() / 1e9) + '\n';
+  out += name_str + "_count " + to_string(count) + '\n';
+}
+
+void metrics::RenderCounter(std::string& out, std::string_view name, std::string_view help, uint64_t value) {
+  const string name_str(name);
+  out += "# HELP " + name_str + ' ' + string(help) + '\n';
+  out += "# TYPE " + name_str + " counter\n";
+  out += name_str + ' ' + to_string(value) + '\n';
+}
+
+void metrics::RenderGauge(std::string& out, std::string_view name, std::string_view help, uint64_t value) {
+  const string name_str(name);
+  out += "# HELP " + name_str + ' ' + string(help) + '\n';
+  out += "# TYPE " + name_str + " gauge\n";
+  out += name_str + ' ' + to_string(value) + '\n';
+}
+
+// Renders a counter per syscall number, skipping syscalls that have never been seen.
+static void RenderSyscallCounters(string& out, string_view name, string_view help, const CounterArray<kMaxSyscall>& counters) {
+  const string name_str(name);
+  out += "# HELP " + name_str + ' ' + string(help) + '\n';
+  out += "# TYPE " + name_str + " counter\n";
+  for (size_t i = 0; i < counters.size(); ++i)
+    if (const uint64_t value = counters.Get(i))
+      out += name_str + "{syscall=\"" + to_string(i) + "\"} " + to_string(value) + '\n';
+}
+
+std::string metrics::Render() {
+  string out;
+  RenderSyscallCounters(out, "edb_syscalls_intercepted_total", "Syscalls seen by the syscall hook.", syscalls_intercepted);
+  RenderSyscallCounters(out, "edb_syscalls_handled_total", "Syscalls redirected to the store.", syscalls_handled);
+  RenderCounter(out, "edb_files_opened_total", "Files opened from the store.", files_opened.Get());
+  store_get_latency.Render(out, "edb_store_get_seconds", "Latency of store reads.");
+  store_put_latency.Render(out, "edb_store_put_seconds", "Latency of store puts.");
+  store_delete_latency.Render(out, "edb_store_delete_seconds", "Latency of store deletes.");
+  store_write_latency.Render(out, "edb_store_write_seconds", "Latency of store batch writes.");
+  RenderCounter(out, "edb_wal_flush_requests_total", "Writes that requested a WAL flush.", wal_flush_requests.Get());
+  RenderCounter(out, "edb_wal_flushes_total", "WAL flushes. Concurrent writes share a flush.", wal_flushes.Get());
+  return out;
+}
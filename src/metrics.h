@@ -0,0 +1,151 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace edb {
+namespace metrics {
+
+// Each metric has one slot per thread (modulo kNumSlots) so that threads don't contend when updating it. The slots are
+// only summed when the metrics are read.
+constexpr size_t kNumSlots = 16;
+
+// Returns the slot of the calling thread.
+size_t ThreadSlot() noexcept;
+
+// CounterArray is a fixed number of monotonic counters, e.g., one per syscall number.
+template <size_t N>
+class CounterArray final {
+ public:
+  void Add(size_t i, uint64_t value = 1) noexcept {
+    slots_[ThreadSlot()].values[i].fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t Get(size_t i) const noexcept {
+    uint64_t result = 0;
+    for (const auto& slot : slots_)
+      result += slot.values[i].load(std::memory_order_relaxed);
+    return result;
+  }
+
+  static constexpr size_t size() noexcept {
+    return N;
+  }
+
+ private:
+  struct alignas(64) Slot {
+    std::array<std::atomic<uint64_t>, N> values{};
+  };
+  std::array<Slot, kNumSlots> slots_;
+};
+
+class Counter final {
+ public:
+  void Add(uint64_t value = 1) noexcept {
+    counters_.Add(0, value);
+  }
+
+  uint64_t Get() const noexcept {
+    return counters_.Get(0);
+  }
+
+ private:
+  CounterArray<1> counters_;
+};
+
+// Histogram counts latencies in exponential buckets from 1 us to about 1 s.
+class Histogram final {
+ public:
+  static constexpr size_t kNumBuckets = 21;
+
+  // Returns the upper bound of bucket i in ns.
+  static constexpr uint64_t BucketBound(size_t i) noexcept {
+    return uint64_t{1000} << i;
+  }
+
+  // Records count observations of latency, e.g., for a sample that stands for count operations.
+  void Observe(std::chrono::nanoseconds latency, uint64_t count = 1) noexcept;
+
+  // Appends the histogram in the Prometheus text format.
+  void Render(std::string& out, std::string_view name, std::string_view help) const;
+
+ private:
+  // the last bucket counts values greater than all bounds
+  CounterArray<kNumBuckets + 1> buckets_;
+  Counter sum_ns_;
+};
+
+// Each thread only times every kTimerSampleRate-th ScopedTimer, because reading the clock may be a host call in the
+// enclave. A sample is observed kTimerSampleRate times, so the histogram's count and sum estimate all operations.
+constexpr uint64_t kTimerSampleRate = 16;
+
+// Measures the time from construction to destruction if the timer is sampled.
+class ScopedTimer final {
+ public:
+  explicit ScopedTimer(Histogram& histogram) noexcept : histogram_(histogram), sampled_(++thread_timers_ % kTimerSampleRate == 0) {
+    if (sampled_)
+      start_ = std::chrono::steady_clock::now();
+  }
+
+  ~ScopedTimer() {
+    if (sampled_)
+      histogram_.Observe(std::chrono::steady_clock::now() - start_, kTimerSampleRate);
+  }
+
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  static inline thread_local uint64_t thread_timers_ = 0;
+
+  Histogram& histogram_;
+  const bool sampled_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// syscall numbers on x86-64 are below this
+constexpr size_t kMaxSyscall = 512;
+
+// syscall hook
+extern CounterArray<kMaxSyscall> syscalls_intercepted;
+extern CounterArray<kMaxSyscall> syscalls_handled;
+
+// SyscallHandler
+extern Counter files_opened;
+
+// RocksDB store
+extern Histogram store_get_latency;
+extern Histogram store_put_latency;
+extern Histogram store_delete_latency;
+extern Histogram store_write_latency;
+extern Counter wal_flush_requests;
+extern Counter wal_flushes;
+
+// Appends a single value in the Prometheus text format.
+void RenderCounter(std::string& out, std::string_view name, std::string_view help, uint64_t value);
+void RenderGauge(std::string& out, std::string_view name, std::string_view help, uint64_t value);
+
+// Returns all metrics above in the Prometheus text format.
+std::string Render();
+
+}  // namespace metrics
+}  // namespace edb
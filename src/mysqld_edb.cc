@@ -14,21 +14,42 @@
    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
 
 #include <netdb.h>
+#include <sys/socket.h>
+
+#include <mutex>
 
 #include "my_global.h"
 //
 #include "log.h"
+#include "query_cache_stats.h"
+#include "sql_cache.h"
 
 static constexpr auto kEdbInternalAddr = "EDB_INTERNAL_ADDR";  // must be kept sync with edb/db/mariadb.go
 
 extern "C" int edgeless_listen_internal_ready;
 int edgeless_listen_internal_ready;
 
+// Guards publishing, shutting down, and closing the internal listen socket, so that edgeless_stop_listen_internal
+// cannot shut down a closed or reused fd.
+static std::mutex listen_internal_mutex;
+static int listen_internal_fd = -1;   // guarded by listen_internal_mutex
+static bool listen_internal_stopped;  // guarded by listen_internal_mutex
+
 static void AbortPerror(const char* message) {
   sql_perror(message);
   unireg_abort(1);
 }
 
+// Lets edgeless_listen_internal return so that MariaDB continues its startup. Connections that have already been
+// accepted stay open.
+extern "C" void edgeless_stop_listen_internal() {
+  const std::lock_guard lock(listen_internal_mutex);
+  listen_internal_stopped = true;
+  // wakes up a pending accept
+  if (listen_internal_fd != -1)
+    shutdown(listen_internal_fd, SHUT_RDWR);
+}
+
 void edgeless_listen_internal() {
   const char* edb_internal_addr = getenv(kEdbInternalAddr);
   if (!edb_internal_addr)
@@ -59,22 +80,39 @@ void edgeless_listen_internal() {
   if (mysql_socket_bind(listen_sock, ai->ai_addr, ai->ai_addrlen) != 0)
     AbortPerror("bind");
   freeaddrinfo(ai);
-  if (mysql_socket_listen(listen_sock, 3) != 0)
+  if (mysql_socket_listen(listen_sock, SOMAXCONN) != 0)
     AbortPerror("listen");
 
+  {
+    const std::lock_guard lock(listen_internal_mutex);
+    listen_internal_fd = mysql_socket_getfd(listen_sock);
+  }
   __atomic_store_n(&edgeless_listen_internal_ready, 1, __ATOMIC_SEQ_CST);
 
-  // accept connections
-  do {
+  // Accept connections until edgeless_stop_listen_internal shuts down the socket.
+  for (;;) {
     const auto accepted_sock = mysql_socket_accept(key_socket_client_connection, listen_sock, nullptr, 0);
-    if (mysql_socket_getfd(accepted_sock) == INVALID_SOCKET)
-      AbortPerror("accept");
+    if (mysql_socket_getfd(accepted_sock) == INVALID_SOCKET) {
+      const std::lock_guard lock(listen_internal_mutex);
+      if (!listen_internal_stopped)
+        AbortPerror("accept");
+      // edgeless_stop_listen_internal has already run, so it won't use the fd again
+      listen_internal_fd = -1;
+      if (mysql_socket_close(listen_sock) != 0)
+        AbortPerror("close");
+      return;
+    }
     handle_accepted_socket(accepted_sock, listen_sock);
+  }
+}
 
-    // stop listening if env var has been cleared
-    edb_internal_addr = getenv(kEdbInternalAddr);
-  } while (edb_internal_addr && *edb_internal_addr);
-
-  if (mysql_socket_close(listen_sock) != 0)
-    AbortPerror("close");
+// Returns the values of the Qcache_* status variables for the metrics endpoint.
+extern "C" void edgeless_get_query_cache_stats(EdgelessQueryCacheStats* stats) {
+  // SHOW STATUS reads these without a lock, too
+  stats->free_memory = query_cache.free_memory;
+  stats->queries = query_cache.queries_in_cache;
+  stats->hits = query_cache.hits;
+  stats->inserts = query_cache.inserts;
+  stats->not_cached = query_cache.refused;
+  stats->lowmem_prunes = query_cache.lowmem_prunes;
 }
@@ -19,6 +19,11 @@ enum oe_fd_type_t {
 
 struct oe_fd_t;
 
+struct oe_iovec {
+  void* iov_base;
+  size_t iov_len;
+};
+
 /* Common operations on file-descriptor objects. */
 typedef struct _oe_fd_ops {
   ssize_t (*read)(oe_fd_t* desc, void* buf, size_t count);
@@ -73,3 +78,12 @@ struct oe_fd_t {
 };
 
 extern "C" int oe_fdtable_assign(oe_fd_t* desc);
+
+typedef struct _oe_malloc_stats {
+  uint64_t peak_system_bytes;
+  uint64_t system_bytes;
+  uint64_t in_use_bytes;
+} oe_malloc_stats_t;
+
+extern "C" oe_result_t oe_get_malloc_stats(oe_malloc_stats_t* stats);
+extern "C" size_t __oe_get_heap_size();
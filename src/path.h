@@ -0,0 +1,99 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace edb {
+
+enum class PathKind {
+  kNone,     // not a path handled by SyscallHandler
+  kFolder,   // ./db or ./db/
+  kDbOpt,    // ./db/db.opt
+  kFrm,      // ./db/table.frm
+  kTempFrm,  // ./db/table.frm~
+};
+
+struct PathInfo {
+  PathKind kind = PathKind::kNone;
+  std::string_view db;
+  std::string_view table;  // only set for kFrm and kTempFrm
+};
+
+namespace path_internal {
+// Names of databases and tables must not contain '.' or '/'.
+constexpr size_t NameLength(std::string_view str) noexcept {
+  size_t i = 0;
+  while (i < str.size() && str[i] != '.' && str[i] != '/')
+    ++i;
+  return i;
+}
+}  // namespace path_internal
+
+// Classifies a path relative to the data directory that doesn't start with "./". It does not allocate and the
+// returned views point into path.
+constexpr PathInfo ParseRelativePath(std::string_view path) noexcept {
+  using path_internal::NameLength;
+
+  PathInfo result;
+
+  const size_t db_len = NameLength(path);
+  if (db_len == 0)
+    return {};
+  result.db = path.substr(0, db_len);
+  path.remove_prefix(db_len);
+
+  if (path.empty() || path == "/") {
+    result.kind = PathKind::kFolder;
+    return result;
+  }
+  if (path[0] != '/')
+    return {};
+  path.remove_prefix(1);
+
+  if (path == "db.opt") {
+    result.kind = PathKind::kDbOpt;
+    return result;
+  }
+
+  const size_t table_len = NameLength(path);
+  if (table_len == 0)
+    return {};
+  result.table = path.substr(0, table_len);
+  path.remove_prefix(table_len);
+
+  if (path == ".frm")
+    result.kind = PathKind::kFrm;
+  else if (path == ".frm~")
+    result.kind = PathKind::kTempFrm;
+  else
+    return {};
+  return result;
+}
+
+// Classifies a path relative to the data directory, e.g., "./db/table.frm".
+constexpr PathInfo ParsePath(std::string_view path) noexcept {
+  if (path.size() < 2 || path[0] != '.' || path[1] != '/')
+    return {};
+  return ParseRelativePath(path.substr(2));
+}
+
+constexpr bool IsKnownFile(const PathInfo& info) noexcept {
+  return info.kind == PathKind::kDbOpt || info.kind == PathKind::kFrm;
+}
+
+}  // namespace edb
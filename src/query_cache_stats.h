@@ -0,0 +1,33 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+// Interface between MariaDB's query cache in src/mysqld_edb.cc and the metrics in src/syscall_hook.cc, which are
+// compiled as parts of different libraries.
+
+#pragma once
+
+#include <cstdint>
+
+// Values of the Qcache_* status variables.
+struct EdgelessQueryCacheStats {
+  uint64_t free_memory;
+  uint64_t queries;
+  uint64_t hits;
+  uint64_t inserts;
+  uint64_t not_cached;
+  uint64_t lowmem_prunes;
+};
+
+extern "C" void edgeless_get_query_cache_stats(EdgelessQueryCacheStats* stats);
@@ -15,10 +15,18 @@
 
 #include "rocksdb.h"
 
+#include <rocksdb/statistics.h>
+#include <rocksdb/utilities/checkpoint.h>
 #include <rocksdb/utilities/transaction_db.h>
+#include <rocksdb/write_batch.h>
 
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include <stdexcept>
 
+#include "metrics.h"
+
 // we need to use things from mariadb/storage/rocksdb/ha_rocksdb.cc
 namespace myrocks {
 extern rocksdb::TransactionDB* rdb;
@@ -38,6 +46,7 @@ static rocksdb::ColumnFamilyHandle* GetCf(string_view name) {
 std::optional<std::string> RocksDB::Get(std::string_view column_family, std::string_view key) const {
   if (!myrocks::rdb)
     return {};
+  const metrics::ScopedTimer timer(metrics::store_get_latency);
   string value;
   const auto status = myrocks::rdb->Get({}, GetCf(column_family), key, &value);
   if (status.ok())
@@ -47,32 +56,226 @@ std::optional<std::string> RocksDB::Get(std::string_view column_family, std::str
   throw runtime_error("rocksdb: " + status.ToString());
 }
 
+namespace {
+// Keeps the value pinned in the block cache or memtable.
+class RocksDBPinnedValue final : public Store::PinnedValue {
+ public:
+  std::string_view Data() const noexcept override {
+    return {slice.data(), slice.size()};
+  }
+
+  rocksdb::PinnableSlice slice;
+};
+}  // namespace
+
+Store::PinnedValuePtr RocksDB::GetPinned(std::string_view column_family, std::string_view key) const {
+  if (!myrocks::rdb)
+    return nullptr;
+  const metrics::ScopedTimer timer(metrics::store_get_latency);
+  auto value = make_unique<RocksDBPinnedValue>();
+  const auto status = myrocks::rdb->Get({}, GetCf(column_family), key, &value->slice);
+  if (status.ok())
+    return value;
+  if (status.IsNotFound())
+    return nullptr;
+  throw runtime_error("rocksdb: " + status.ToString());
+}
+
 void RocksDB::Put(std::string_view column_family, std::string_view key, std::string_view value) {
   if (!myrocks::rdb)
     throw logic_error("rocksdb: put called before store has been initialized");
+  const metrics::ScopedTimer timer(metrics::store_put_latency);
   const auto status = myrocks::rdb->Put({}, GetCf(column_family), key, value);
   if (!status.ok())
     throw runtime_error("rocksdb: " + status.ToString());
-  // MyRocks disables automatic flush in RocksDB, so we must flush manually.
-  myrocks::rdb->FlushWAL(true);
+  FlushWal();
 }
 
 void RocksDB::Delete(std::string_view column_family, std::string_view key) {
   if (!myrocks::rdb)
     throw logic_error("rocksdb: delete called before store has been initialized");
+  const metrics::ScopedTimer timer(metrics::store_delete_latency);
   const auto status = myrocks::rdb->Delete({}, GetCf(column_family), key);
   if (!status.ok())
     throw runtime_error("rocksdb: " + status.ToString());
-  // see comment in Put
-  myrocks::rdb->FlushWAL(true);
+  FlushWal();
 }
 
-std::vector<std::string> RocksDB::GetKeys(std::string_view column_family, std::string_view prefix) const {
+void RocksDB::Write(const WriteBatch& batch) {
   if (!myrocks::rdb)
-    return {};
-  const unique_ptr<rocksdb::Iterator> it(myrocks::rdb->NewIterator({}, GetCf(column_family)));
-  vector<string> result;
-  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next())
-    result.push_back(it->key().ToString());
+    throw logic_error("rocksdb: write called before store has been initialized");
+  const metrics::ScopedTimer timer(metrics::store_write_latency);
+
+  rocksdb::WriteBatch rocksdb_batch;
+  for (const auto& op : batch.Ops()) {
+    const auto status = op.value
+                            ? rocksdb_batch.Put(GetCf(op.column_family), op.key, *op.value)
+                            : rocksdb_batch.Delete(GetCf(op.column_family), op.key);
+    if (!status.ok())
+      throw runtime_error("rocksdb: " + status.ToString());
+  }
+
+  const auto status = myrocks::rdb->Write({}, &rocksdb_batch);
+  if (!status.ok())
+    throw runtime_error("rocksdb: " + status.ToString());
+  FlushWal();
+}
+
+void RocksDB::FlushWal() {
+  // MyRocks disables automatic flush in RocksDB, so we must flush manually. Syncing the WAL is expensive, so we let one
+  // thread flush on behalf of all threads that have written in the meantime (group commit).
+  metrics::wal_flush_requests.Add();
+  unique_lock lock(wal_mutex_);
+  const uint64_t ticket = ++wal_written_;
+
+  while (wal_flushed_ < ticket) {
+    if (wal_flushing_) {
+      wal_cv_.wait(lock);
+      continue;
+    }
+
+    // This flush covers all writes that have a ticket.
+    wal_flushing_ = true;
+    const uint64_t target = wal_written_;
+    lock.unlock();
+    metrics::wal_flushes.Add();
+    const auto status = myrocks::rdb->FlushWAL(true);
+    lock.lock();
+    wal_flushing_ = false;
+    if (status.ok())
+      wal_flushed_ = max(wal_flushed_, target);
+    wal_cv_.notify_all();
+
+    if (!status.ok())
+      throw runtime_error("rocksdb: " + status.ToString());
+  }
+}
+
+// Returns the smallest string that is greater than all strings starting with prefix, or an empty string if there is none.
+static string PrefixUpperBound(string_view prefix) {
+  string result(prefix);
+  while (!result.empty() && static_cast<unsigned char>(result.back()) == 0xFF)
+    result.pop_back();
+  if (!result.empty())
+    ++result.back();
   return result;
 }
+
+// Calls f for each entry in column_family whose key starts with prefix until f returns false.
+static void Iterate(std::string_view column_family, std::string_view prefix, const function<bool(const rocksdb::Iterator&)>& f) {
+  // The upper bound lets RocksDB stop at the end of the prefix range without reading the following keys and blocks.
+  const string upper_bound = PrefixUpperBound(prefix);
+  const rocksdb::Slice upper_bound_slice = upper_bound;
+  rocksdb::ReadOptions options;
+  if (!upper_bound.empty())
+    options.iterate_upper_bound = &upper_bound_slice;
+
+  const unique_ptr<rocksdb::Iterator> it(myrocks::rdb->NewIterator(options, GetCf(column_family)));
+  for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next())
+    if (!f(*it))
+      return;
+  if (!it->status().ok())
+    throw runtime_error("rocksdb: " + it->status().ToString());
+}
+
+void RocksDB::ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const {
+  if (!myrocks::rdb)
+    return;
+  Iterate(column_family, prefix, [&f](const rocksdb::Iterator& it) {
+    const auto key = it.key();
+    f({key.data(), key.size()});
+    return true;
+  });
+}
+
+void RocksDB::ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const {
+  if (!myrocks::rdb)
+    return;
+  Iterate(column_family, prefix, [&f](const rocksdb::Iterator& it) {
+    const auto key = it.key();
+    const auto value = it.value();
+    return f({key.data(), key.size()}, {value.data(), value.size()});
+  });
+}
+
+namespace {
+struct TickerMetric {
+  rocksdb::Tickers ticker;
+  const char* name;
+  const char* help;
+};
+
+struct PropertyMetric {
+  const std::string& property;
+  bool per_cf;  // sum over column families
+  const char* name;
+  const char* help;
+};
+}  // namespace
+
+void RocksDB::RenderMetrics(std::string& out) {
+  if (!myrocks::rdb)
+    return;
+
+  // These are reviewed to only contain performance data. Don't add metrics that depend on the database content, e.g.,
+  // the estimated number of keys.
+  static const TickerMetric tickers[]{
+      {rocksdb::BLOCK_CACHE_HIT, "block_cache_hit", "Block cache hits."},
+      {rocksdb::BLOCK_CACHE_MISS, "block_cache_miss", "Block cache misses."},
+      {rocksdb::BLOCK_CACHE_DATA_HIT, "block_cache_data_hit", "Block cache hits of data blocks."},
+      {rocksdb::BLOCK_CACHE_DATA_MISS, "block_cache_data_miss", "Block cache misses of data blocks."},
+      {rocksdb::BLOCK_CACHE_INDEX_HIT, "block_cache_index_hit", "Block cache hits of index blocks."},
+      {rocksdb::BLOCK_CACHE_INDEX_MISS, "block_cache_index_miss", "Block cache misses of index blocks."},
+      {rocksdb::BLOCK_CACHE_FILTER_HIT, "block_cache_filter_hit", "Block cache hits of filter blocks."},
+      {rocksdb::BLOCK_CACHE_FILTER_MISS, "block_cache_filter_miss", "Block cache misses of filter blocks."},
+      {rocksdb::MEMTABLE_HIT, "memtable_hit", "Reads served from memtables."},
+      {rocksdb::MEMTABLE_MISS, "memtable_miss", "Reads not served from memtables."},
+      {rocksdb::BLOOM_FILTER_USEFUL, "bloom_filter_useful", "Reads avoided by bloom filters."},
+      {rocksdb::BYTES_WRITTEN, "bytes_written", "Bytes written by the user."},
+      {rocksdb::BYTES_READ, "bytes_read", "Bytes read by the user."},
+      {rocksdb::FLUSH_WRITE_BYTES, "flush_write_bytes", "Bytes written by memtable flushes."},
+      {rocksdb::COMPACT_READ_BYTES, "compact_read_bytes", "Bytes read by compactions."},
+      {rocksdb::COMPACT_WRITE_BYTES, "compact_write_bytes", "Bytes written by compactions."},
+      {rocksdb::STALL_MICROS, "stall_micros", "Time writes were stalled in microseconds."},
+      {rocksdb::WAL_FILE_SYNCED, "wal_file_synced", "WAL syncs."},
+      {rocksdb::WAL_FILE_BYTES, "wal_file_bytes", "Bytes written to the WAL."},
+  };
+
+  static const PropertyMetric properties[]{
+      {rocksdb::DB::Properties::kBlockCacheCapacity, false, "block_cache_capacity_bytes", "Block cache capacity."},
+      {rocksdb::DB::Properties::kBlockCacheUsage, false, "block_cache_usage_bytes", "Memory used by the block cache."},
+      {rocksdb::DB::Properties::kBlockCachePinnedUsage, false, "block_cache_pinned_usage_bytes", "Memory used by pinned blocks."},
+      {rocksdb::DB::Properties::kCurSizeAllMemTables, true, "memtables_size_bytes", "Memory used by memtables."},
+      {rocksdb::DB::Properties::kNumRunningFlushes, false, "running_flushes", "Running memtable flushes."},
+      {rocksdb::DB::Properties::kNumRunningCompactions, false, "running_compactions", "Running compactions."},
+      {rocksdb::DB::Properties::kEstimatePendingCompactionBytes, true, "pending_compaction_bytes", "Estimated bytes compactions need to rewrite."},
+      {rocksdb::DB::Properties::kActualDelayedWriteRate, false, "delayed_write_rate", "Current write rate limit in bytes/s, 0 if writes are not delayed."},
+      {rocksdb::DB::Properties::kIsWriteStopped, false, "write_stopped", "1 if writes are stopped."},
+  };
+
+  if (const auto statistics = myrocks::rdb->GetDBOptions().statistics) {
+    for (const auto& t : tickers)
+      metrics::RenderCounter(out, "edb_rocksdb_"s + t.name + "_total", t.help, statistics->getTickerCount(t.ticker));
+  }
+
+  for (const auto& p : properties) {
+    uint64_t value = 0;
+    if (p.per_cf ? myrocks::rdb->GetAggregatedIntProperty(p.property, &value) : myrocks::rdb->GetIntProperty(p.property, &value))
+      metrics::RenderGauge(out, "edb_rocksdb_"s + p.name, p.help, value);
+  }
+}
+
+void RocksDB::CreateCheckpoint(const std::string& dir) {
+  if (!myrocks::rdb)
+    throw logic_error("rocksdb: checkpoint requested before store has been initialized");
+
+  rocksdb::Checkpoint* checkpoint = nullptr;
+  auto status = rocksdb::Checkpoint::Create(myrocks::rdb, &checkpoint);
+  if (!status.ok())
+    throw runtime_error("rocksdb: " + status.ToString());
+  const unique_ptr<rocksdb::Checkpoint> checkpoint_ptr(checkpoint);
+
+  status = checkpoint->CreateCheckpoint(dir);
+  if (!status.ok())
+    throw runtime_error("rocksdb: " + status.ToString());
+}
@@ -15,6 +15,11 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
 #include "store.h"
 
 namespace edb {
@@ -22,9 +27,30 @@ namespace edb {
 class RocksDB final : public Store {
  public:
   std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override;
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override;
   void Put(std::string_view column_family, std::string_view key, std::string_view value) override;
   void Delete(std::string_view column_family, std::string_view key) override;
-  std::vector<std::string> GetKeys(std::string_view column_family, std::string_view prefix) const override;
+  void Write(const WriteBatch& batch) override;
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override;
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override;
+
+  // Appends RocksDB statistics in the Prometheus text format. Only performance counters are included that don't
+  // reveal keys, values, or the number of rows.
+  static void RenderMetrics(std::string& out);
+
+  // Creates a checkpoint of the database in dir, which must not exist. SST files are hard-linked if possible, so this
+  // is cheap, and writes continue meanwhile.
+  static void CreateCheckpoint(const std::string& dir);
+
+ private:
+  // Makes all preceding writes of the calling thread durable. Concurrent callers share a single WAL flush.
+  void FlushWal();
+
+  std::mutex wal_mutex_;
+  std::condition_variable wal_cv_;
+  uint64_t wal_written_ = 0;  // number of writes that have been added to the WAL buffer
+  uint64_t wal_flushed_ = 0;  // number of writes that are known to be durable
+  bool wal_flushing_ = false;
 };
 
 }  // namespace edb
@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -23,13 +24,55 @@
 
 namespace edb {
 
+// Store implementations must be safe to use from multiple threads concurrently.
 class Store {
  public:
+  // WriteBatch collects updates that Write applies atomically.
+  class WriteBatch {
+   public:
+    struct Op {
+      std::string column_family;
+      std::string key;
+      std::optional<std::string> value;  // none means delete
+    };
+
+    void Put(std::string_view column_family, std::string_view key, std::string_view value) {
+      ops_.push_back({std::string(column_family), std::string(key), std::string(value)});
+    }
+
+    void Delete(std::string_view column_family, std::string_view key) {
+      ops_.push_back({std::string(column_family), std::string(key), {}});
+    }
+
+    const std::vector<Op>& Ops() const noexcept {
+      return ops_;
+    }
+
+   private:
+    std::vector<Op> ops_;
+  };
+
+  // PinnedValue gives access to a value without copying it out of the store. The data stays valid as long as the
+  // PinnedValue exists.
+  class PinnedValue {
+   public:
+    virtual ~PinnedValue() = default;
+    virtual std::string_view Data() const noexcept = 0;
+  };
+  typedef std::unique_ptr<const PinnedValue> PinnedValuePtr;
+
   virtual ~Store() = default;
   virtual std::optional<std::string> Get(std::string_view column_family, std::string_view key) const = 0;
+  // Like Get, but avoids copying the value. Returns nullptr if the key does not exist.
+  virtual PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const = 0;
   virtual void Put(std::string_view column_family, std::string_view key, std::string_view value) = 0;
   virtual void Delete(std::string_view column_family, std::string_view key) = 0;
-  virtual std::vector<std::string> GetKeys(std::string_view column_family, std::string_view prefix) const = 0;
+  virtual void Write(const WriteBatch& batch) = 0;
+  // Calls f for each key in column_family that starts with prefix, in ascending order. The key is only valid during
+  // the call.
+  virtual void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const = 0;
+  // Like ForEachKey, but also passes the value and stops early if f returns false.
+  virtual void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const = 0;
 };
 
 typedef std::shared_ptr<Store> StorePtr;
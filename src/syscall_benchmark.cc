@@ -0,0 +1,441 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#ifdef EDB_BENCHMARK_ENCLAVE
+#include <openenclave/ert.h>
+#include <sys/mount.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <regex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark_rocksdb.h"
+#include "cached_store.h"
+#include "oe_internal.h"
+#include "path.h"
+#include "syscall_handler.h"
+
+using namespace std;
+using namespace edb;
+
+namespace edb {
+// will be overridden for benchmarking
+extern function<decltype(oe_fdtable_assign)> fdtable_assign;
+}  // namespace edb
+
+namespace {
+// Keeps the compiler from optimizing away the benchmarked code.
+template <typename T>
+void DoNotOptimize(const T& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template <typename F>
+double MeasureNsPerOp(size_t iterations, F&& f) {
+  const auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i)
+    f(i);
+  const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+// Returns the latency of each call to f in ns.
+template <typename F>
+vector<double> MeasureLatencies(size_t iterations, F&& f) {
+  vector<double> result(iterations);
+  for (size_t i = 0; i < iterations; ++i) {
+    const auto start = chrono::steady_clock::now();
+    f(i);
+    const chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+    result[i] = elapsed.count();
+  }
+  return result;
+}
+
+void PrintResult(string_view name, double ns_per_op) {
+  cout << left << setw(40) << name << right << setw(12) << fixed << setprecision(1) << ns_per_op << " ns/op\n";
+}
+
+void PrintLatencies(string_view name, vector<double> latencies) {
+  sort(latencies.begin(), latencies.end());
+  const auto percentile = [&latencies](double p) {
+    return latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+  };
+  const double total = accumulate(latencies.cbegin(), latencies.cend(), 0.0);
+  cout << left << setw(40) << name << right << fixed << setprecision(0)
+       << setw(12) << latencies.size() / total * 1e9 << " ops/s"
+       << setw(12) << percentile(0.5) << " ns p50"
+       << setw(12) << percentile(0.99) << " ns p99\n";
+}
+
+void Check(bool ok, string_view operation) {
+  if (!ok) {
+    cout << operation << " failed\n";
+    exit(EXIT_FAILURE);
+  }
+}
+
+long Arg(const void* p) {
+  return reinterpret_cast<long>(p);
+}
+
+struct StringValue final : Store::PinnedValue {
+  explicit StringValue(string value)
+      : value(move(value)) {
+  }
+
+  std::string_view Data() const noexcept override {
+    return value;
+  }
+
+  const string value;
+};
+
+// Fake in-memory store that can be used concurrently like RocksDB.
+class MapStore final : public Store {
+ public:
+  std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override {
+    const shared_lock lock(mutex_);
+    const auto it1 = data_.find(column_family);
+    if (it1 == data_.cend())
+      return {};
+    const auto it2 = it1->second.find(key);
+    if (it2 == it1->second.cend())
+      return {};
+    return it2->second;
+  }
+
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override {
+    auto value = Get(column_family, key);
+    if (!value)
+      return nullptr;
+    return make_unique<StringValue>(move(*value));
+  }
+
+  void Put(std::string_view column_family, std::string_view key, std::string_view value) override {
+    const lock_guard lock(mutex_);
+    data_[string(column_family)][string(key)] = value;
+  }
+
+  void Delete(std::string_view column_family, std::string_view key) override {
+    const lock_guard lock(mutex_);
+    data_[string(column_family)].erase(string(key));
+  }
+
+  void Write(const WriteBatch& batch) override {
+    const lock_guard lock(mutex_);
+    for (const auto& op : batch.Ops())
+      if (op.value)
+        data_[op.column_family][op.key] = *op.value;
+      else
+        data_[op.column_family].erase(op.key);
+  }
+
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override {
+    const shared_lock lock(mutex_);
+    const auto it = data_.find(column_family);
+    if (it == data_.cend())
+      return;
+    for (auto it2 = it->second.lower_bound(prefix); it2 != it->second.cend() && it2->first.compare(0, prefix.size(), prefix) == 0; ++it2)
+      f(it2->first);
+  }
+
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override {
+    const shared_lock lock(mutex_);
+    const auto it = data_.find(column_family);
+    if (it == data_.cend())
+      return;
+    for (auto it2 = it->second.lower_bound(prefix); it2 != it->second.cend() && it2->first.compare(0, prefix.size(), prefix) == 0; ++it2)
+      if (!f(it2->first, it2->second))
+        return;
+  }
+
+ private:
+  mutable shared_mutex mutex_;
+  map<string, map<string, string, less<>>, less<>> data_;
+};
+
+// Serializes all accesses to another store with a single mutex, like SyscallHandler did before it used per-key locks.
+class GlobalLockStore final : public Store {
+ public:
+  explicit GlobalLockStore(StorePtr store)
+      : store_(move(store)) {
+  }
+
+  std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override {
+    const lock_guard lock(mutex_);
+    return store_->Get(column_family, key);
+  }
+
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override {
+    const lock_guard lock(mutex_);
+    return store_->GetPinned(column_family, key);
+  }
+
+  void Put(std::string_view column_family, std::string_view key, std::string_view value) override {
+    const lock_guard lock(mutex_);
+    store_->Put(column_family, key, value);
+  }
+
+  void Delete(std::string_view column_family, std::string_view key) override {
+    const lock_guard lock(mutex_);
+    store_->Delete(column_family, key);
+  }
+
+  void Write(const WriteBatch& batch) override {
+    const lock_guard lock(mutex_);
+    store_->Write(batch);
+  }
+
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override {
+    const lock_guard lock(mutex_);
+    store_->ForEachKey(column_family, prefix, f);
+  }
+
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override {
+    const lock_guard lock(mutex_);
+    store_->ForEach(column_family, prefix, f);
+  }
+
+ private:
+  const StorePtr store_;
+  mutable mutex mutex_;
+};
+}  // namespace
+
+// The std::regex based classification that SyscallHandler used before ParsePath.
+static PathKind RegexClassify(const string& path) {
+  static const regex re_folder(R"(\./[^./]+/?)");
+  static const regex re_path_to_known_file(R"(\./[^./]+/(db\.opt|[^./]+\.frm))");
+  static const regex re_path_to_temp_frm_file(R"(\./[^./]+/[^./]+\.frm~)");
+
+  if (regex_match(path, re_folder))
+    return PathKind::kFolder;
+  if (regex_match(path, re_path_to_known_file))
+    return path.compare(path.size() - 4, 4, ".frm") == 0 ? PathKind::kFrm : PathKind::kDbOpt;
+  if (regex_match(path, re_path_to_temp_frm_file))
+    return PathKind::kTempFrm;
+  return PathKind::kNone;
+}
+
+static void BenchmarkPathClassification(size_t iterations) {
+  // a mix of the paths that MariaDB and RocksDB access in the data directory
+  const vector<string> paths{
+      "./#rocksdb/000042.sst",
+      "./#rocksdb/000043.log",
+      "./#rocksdb/MANIFEST-000005",
+      "./mydb",
+      "./mydb/",
+      "./mydb/db.opt",
+      "./mydb/customers.frm",
+      "./mydb/#sql-alter-1f-4.frm~",
+      "./mydb/invalid.name.frm",
+  };
+
+  // both implementations must agree
+  for (const auto& path : paths) {
+    if (ParsePath(path).kind != RegexClassify(path)) {
+      cout << "mismatch for " << path << '\n';
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  cout << "path classification (" << paths.size() << " paths)\n";
+  PrintResult("std::regex", MeasureNsPerOp(iterations, [&paths](size_t i) {
+                DoNotOptimize(RegexClassify(paths[i % paths.size()]));
+              }));
+  PrintResult("ParsePath", MeasureNsPerOp(iterations, [&paths](size_t i) {
+                DoNotOptimize(ParsePath(paths[i % paths.size()]));
+              }));
+}
+
+// Stores num_tables .frm files of frm_size bytes each in a new database and returns their paths.
+static vector<string> CreateTables(Store& store, string_view db, size_t num_tables, size_t frm_size) {
+  const string frm(frm_size, 'x');
+  const string prefix = "./" + string(db) + '/';
+  vector<string> paths;
+  Store::WriteBatch batch;
+  batch.Put(kCfNameDb, prefix + "db.opt", {});
+  for (size_t i = 0; i < num_tables; ++i) {
+    paths.push_back(prefix + 't' + to_string(i) + ".frm");
+    batch.Put(kCfNameFrm, paths.back(), frm);
+  }
+  store.Write(batch);
+  return paths;
+}
+
+// Measures the syscalls that SyscallHandler redirects to the store, using the same cache as edb.
+static void BenchmarkOperations(const StorePtr& backing, size_t iterations) {
+  static oe_fd_t* file;
+  fdtable_assign = [](oe_fd_t* desc) {
+    file = desc;
+    return 3;
+  };
+
+  // writes flush the WAL and directory listings scan all tables, so run fewer of them
+  const size_t write_iterations = max<size_t>(iterations / 100, 10) & ~size_t{1};
+
+  for (const size_t num_tables : {100, 10000})
+    for (const size_t frm_size : {1024, 16384}) {
+      const string db = "ops_" + to_string(num_tables) + '_' + to_string(frm_size);
+      const auto paths = CreateTables(*backing, db, num_tables, frm_size);
+      const string db_path = "./" + db;
+      const string renamed_path = db_path + "/renamed.frm";
+      const size_t dir_iterations = max<size_t>(iterations / num_tables, 10);
+      const auto path = [&paths](size_t i) { return paths[i % paths.size()].c_str(); };
+      string buf(frm_size, 'x');
+
+      SyscallHandler handler(make_shared<CachedStore>(backing, kDefaultMetadataCacheSize));
+      cout << "operations (" << num_tables << " tables, " << frm_size << " bytes per .frm)\n";
+
+      PrintLatencies("open+close", MeasureLatencies(iterations, [&](size_t i) {
+                       Check(handler.Syscall(SYS_open, Arg(path(i)), O_RDONLY) == 3 && file->ops.fd.close(file) == 0, "open");
+                     }));
+      PrintLatencies("stat", MeasureLatencies(iterations, [&](size_t i) {
+                       struct stat st {};
+                       Check(handler.Syscall(SYS_stat, Arg(path(i)), Arg(&st)) == 0, "stat");
+                     }));
+      PrintLatencies("access", MeasureLatencies(iterations, [&](size_t i) {
+                       Check(handler.Syscall(SYS_access, Arg(path(i)), F_OK) == 0, "access");
+                     }));
+      PrintLatencies("open+read+close", MeasureLatencies(iterations, [&](size_t i) {
+                       Check(handler.Syscall(SYS_open, Arg(path(i)), O_RDONLY) == 3 &&
+                                 file->ops.fd.read(file, buf.data(), buf.size()) == static_cast<ssize_t>(buf.size()) &&
+                                 file->ops.fd.close(file) == 0,
+                             "read");
+                     }));
+      PrintLatencies("open+write+close", MeasureLatencies(write_iterations, [&](size_t i) {
+                       Check(handler.Syscall(SYS_open, Arg(path(i)), O_WRONLY | O_CREAT | O_TRUNC) == 3 &&
+                                 file->ops.fd.write(file, buf.data(), buf.size()) == static_cast<ssize_t>(buf.size()) &&
+                                 file->ops.fd.close(file) == 0,
+                             "write");
+                     }));
+      PrintLatencies("rename", MeasureLatencies(write_iterations, [&](size_t i) {
+                       // move the first table back and forth
+                       const char* from = i % 2 ? renamed_path.c_str() : path(0);
+                       const char* to = i % 2 ? path(0) : renamed_path.c_str();
+                       Check(handler.Syscall(SYS_rename, Arg(from), Arg(to)) == 0, "rename");
+                     }));
+      PrintLatencies("dir", MeasureLatencies(dir_iterations, [&](size_t) {
+                       size_t count = 0;
+                       handler.Dir(db_path, [&count](string_view) { ++count; });
+                       Check(count == num_tables, "dir");
+                     }));
+    }
+}
+
+// Measures the throughput of table opens, i.e., open, read, and close of .frm files, with increasing numbers of threads.
+static void BenchmarkConcurrentOpen(const StorePtr& backing, size_t iterations) {
+  constexpr size_t kNumTables = 1000;
+  constexpr size_t kFrmSize = 4096;
+  const auto paths = CreateTables(*backing, "concurrent", kNumTables, kFrmSize);
+
+  static thread_local oe_fd_t* file;
+  fdtable_assign = [](oe_fd_t* desc) {
+    file = desc;
+    return 3;
+  };
+
+  const auto run = [&paths, iterations](string_view name, const StorePtr& store) {
+    SyscallHandler handler(store);
+    cout << name << '\n';
+
+    for (const size_t num_threads : {1, 2, 4, 8, 16}) {
+      const size_t ops_per_thread = iterations / num_threads;
+      const double ns_per_op = MeasureNsPerOp(1, [&](size_t) {
+        vector<thread> threads;
+        for (size_t t = 0; t < num_threads; ++t)
+          threads.emplace_back([&, t] {
+            string buf(kFrmSize, '\0');
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+              const auto& path = paths[(t * ops_per_thread + i) % paths.size()];
+              if (handler.Syscall(SYS_open, reinterpret_cast<long>(path.c_str()), O_RDONLY) != 3 ||
+                  file->ops.fd.read(file, buf.data(), buf.size()) != static_cast<ssize_t>(buf.size()) ||
+                  file->ops.fd.close(file) != 0) {
+                cout << "open failed for " << path << '\n';
+                exit(EXIT_FAILURE);
+              }
+            }
+          });
+        for (auto& thread : threads)
+          thread.join();
+      });
+      PrintResult(to_string(num_threads) + " threads", ns_per_op / (ops_per_thread * num_threads));
+    }
+  };
+
+  cout << "concurrent table opens (" << kNumTables << " tables)\n";
+  run("single mutex", make_shared<GlobalLockStore>(make_shared<CachedStore>(backing, kDefaultMetadataCacheSize)));
+  run("per-key locking", make_shared<CachedStore>(backing, kDefaultMetadataCacheSize));
+}
+
+int main(int argc, char** argv) {
+  const size_t iterations = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+  const string_view store_name = argc > 2 ? argv[2] : "fake";
+  if (iterations == 0 || !(store_name == "fake" || (store_name == "rocksdb" && argc == 4))) {
+    cout << "usage: " << argv[0] << " [iterations] [fake | rocksdb <empty dir>]\n";
+    return EXIT_FAILURE;
+  }
+
+#ifdef EDB_BENCHMARK_ENCLAVE
+  if (oe_load_module_host_file_system() != OE_OK || mount("/", "/", OE_HOST_FILE_SYSTEM, 0, nullptr) != 0) {
+    cout << "mount hostfs failed\n";
+    return EXIT_FAILURE;
+  }
+#endif
+
+  const StorePtr backing = store_name == "rocksdb" ? OpenBenchmarkRocksDB(argv[3]) : make_shared<MapStore>();
+  cout << "store: " << store_name << '\n';
+
+  BenchmarkPathClassification(iterations);
+  BenchmarkOperations(backing, iterations);
+  BenchmarkConcurrentOpen(backing, iterations);
+
+  CloseBenchmarkRocksDB();
+}
+
+#ifndef EDB_BENCHMARK_ENCLAVE
+// We must define this func to satisfy the linker. It won't be called.
+int oe_fdtable_assign(oe_fd_t* /*desc*/) {
+  abort();
+}
+
+// We must define this func to satisfy the linker.
+oe_result_t oe_log(oe_log_level_t /*level*/, const char* fmt, ...) {
+  va_list valist;
+  va_start(valist, fmt);
+  vprintf(fmt, valist);
+  va_end(valist);
+  return OE_OK;
+}
+#endif
@@ -17,13 +17,16 @@
 
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <exception>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
 
+#include "metrics.h"
 #include "oe_internal.h"
 
 using namespace std;
@@ -37,36 +40,122 @@ function<decltype(oe_fdtable_assign)> fdtable_assign = oe_fdtable_assign;
 namespace {
 struct File {
   oe_fd_t base{};
-  string path;
-  mutex mut;
-  size_t offset = 0;
+  size_t offset = 0;  // guarded by file->mutex
+  shared_ptr<OpenFile> file;
   SyscallHandler* handler = nullptr;
 };
 }  // namespace
 
+// The following functions must be called with file.mutex held.
+
+// Copies the pinned content to the modifiable buffer.
+static void Materialize(OpenFile& file) {
+  if (!file.pinned)
+    return;
+  file.data = file.pinned->Data();
+  file.pinned.reset();
+}
+
+static size_t ReadAt(const OpenFile& file, void* buf, size_t count, size_t offset) {
+  const string_view content = file.Content();
+  if (content.size() <= offset)
+    return 0;
+  count = min(count, content.size() - offset);
+  memcpy(buf, content.data() + offset, count);
+  return count;
+}
+
+// Prepares the buffer for a write. Returns false if the file would become too large.
+static bool Reserve(OpenFile& file, size_t offset, size_t count) {
+  const size_t required_size = offset + count;
+  if (required_size < offset)
+    return false;
+  Materialize(file);
+  if (file.data.size() < required_size)
+    file.data.resize(required_size);
+  return true;
+}
+
 static ssize_t file_read(oe_fd_t* desc, void* buf, size_t count) {
+  auto& fd = *reinterpret_cast<File*>(desc);
+  const lock_guard lock(fd.file->mutex);
+  const size_t res = ReadAt(*fd.file, buf, count, fd.offset);
+  fd.offset += res;
+  return res;
+}
+
+static ssize_t file_write(oe_fd_t* desc, const void* buf, size_t count) {
   try {
-    auto& file = *reinterpret_cast<File*>(desc);
-    const lock_guard lock(file.mut);
-    const size_t res = file.handler->Read(file.path, buf, count, file.offset);
-    file.offset += res;
-    return res;
+    auto& fd = *reinterpret_cast<File*>(desc);
+    auto& file = *fd.file;
+    const lock_guard lock(file.mutex);
+    if (!Reserve(file, fd.offset, count)) {
+      errno = EFBIG;
+      return -1;
+    }
+    memcpy(file.data.data() + fd.offset, buf, count);
+    fd.offset += count;
+    file.dirty = true;
+    return count;
   } catch (const exception& ex) {
-    oe_log(OE_LOG_LEVEL_ERROR, "file_read: %s\n", ex.what());
+    oe_log(OE_LOG_LEVEL_ERROR, "file_write: %s\n", ex.what());
     errno = EIO;
     return -1;
   }
 }
 
-static ssize_t file_write(oe_fd_t* desc, const void* buf, size_t count) {
+static ssize_t file_readv(oe_fd_t* desc, const oe_iovec* iov, int iovcnt) {
+  if (iovcnt < 0 || (iovcnt && !iov)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  auto& fd = *reinterpret_cast<File*>(desc);
+  const lock_guard lock(fd.file->mutex);
+
+  size_t res = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    const size_t count = ReadAt(*fd.file, iov[i].iov_base, iov[i].iov_len, fd.offset);
+    fd.offset += count;
+    res += count;
+    if (count < iov[i].iov_len)
+      break;
+  }
+  return res;
+}
+
+static ssize_t file_writev(oe_fd_t* desc, const oe_iovec* iov, int iovcnt) {
+  if (iovcnt < 0 || (iovcnt && !iov)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  size_t total = 0;
+  for (int i = 0; i < iovcnt; ++i) {
+    total += iov[i].iov_len;
+    if (total < iov[i].iov_len) {
+      errno = EINVAL;
+      return -1;
+    }
+  }
+
   try {
-    auto& file = *reinterpret_cast<File*>(desc);
-    const lock_guard lock(file.mut);
-    file.handler->Write(file.path, string_view(static_cast<const char*>(buf), count), file.offset);
-    file.offset += count;
-    return count;
+    auto& fd = *reinterpret_cast<File*>(desc);
+    auto& file = *fd.file;
+    const lock_guard lock(file.mutex);
+    if (!Reserve(file, fd.offset, total)) {
+      errno = EFBIG;
+      return -1;
+    }
+    for (int i = 0; i < iovcnt; ++i) {
+      memcpy(file.data.data() + fd.offset, iov[i].iov_base, iov[i].iov_len);
+      fd.offset += iov[i].iov_len;
+    }
+    if (total)
+      file.dirty = true;
+    return total;
   } catch (const exception& ex) {
-    oe_log(OE_LOG_LEVEL_ERROR, "file_write: %s\n", ex.what());
+    oe_log(OE_LOG_LEVEL_ERROR, "file_writev: %s\n", ex.what());
     errno = EIO;
     return -1;
   }
@@ -88,7 +177,14 @@ static int file_fcntl(oe_fd_t* /*desc*/, int /*cmd*/, uint64_t /*arg*/) {
 }
 
 static int file_close(oe_fd_t* desc) {
-  delete reinterpret_cast<File*>(desc);
+  const unique_ptr<File> fd(reinterpret_cast<File*>(desc));
+  try {
+    fd->handler->Flush(fd->file, true);
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "file_close: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
   return 0;
 }
 
@@ -98,55 +194,63 @@ static oe_host_fd_t file_get_host_fd(oe_fd_t* /*desc*/) {
 }
 
 static oe_off_t file_lseek(oe_fd_t* desc, oe_off_t offset, int whence) {
-  try {
-    auto& file = *reinterpret_cast<File*>(desc);
-    const lock_guard lock(file.mut);
-
-    switch (whence) {
-      case SEEK_SET:
-        break;
-      case SEEK_CUR:
-        offset += file.offset;
-        break;
-      case SEEK_END:
-        offset += file.handler->Size(file.path);
-        break;
-      default:
-        errno = EINVAL;
-        return -1;
-    }
-
-    if (offset < 0) {
+  auto& fd = *reinterpret_cast<File*>(desc);
+  const lock_guard lock(fd.file->mutex);
+
+  switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += fd.offset;
+      break;
+    case SEEK_END:
+      offset += fd.file->Content().size();
+      break;
+    default:
       errno = EINVAL;
       return -1;
-    }
+  }
 
-    file.offset = offset;
-  } catch (const exception& ex) {
-    oe_log(OE_LOG_LEVEL_ERROR, "file_lseek: %s\n", ex.what());
-    errno = EIO;
+  if (offset < 0) {
+    errno = EINVAL;
     return -1;
   }
 
+  fd.offset = offset;
   return offset;
 }
 
-static ssize_t file_pread(
-    oe_fd_t* /*desc*/,
-    void* /*buf*/,
-    size_t /*count*/,
-    oe_off_t /*offset*/) {
-  errno = ENOSYS;
-  return -1;
+static ssize_t file_pread(oe_fd_t* desc, void* buf, size_t count, oe_off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  auto& file = *reinterpret_cast<File*>(desc)->file;
+  const lock_guard lock(file.mutex);
+  return ReadAt(file, buf, count, offset);
 }
 
-static ssize_t file_pwrite(
-    oe_fd_t* /*desc*/,
-    const void* /*buf*/,
-    size_t /*count*/,
-    oe_off_t /*offset*/) {
-  errno = ENOSYS;
-  return -1;
+static ssize_t file_pwrite(oe_fd_t* desc, const void* buf, size_t count, oe_off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<File*>(desc)->file;
+    const lock_guard lock(file.mutex);
+    if (!Reserve(file, offset, count)) {
+      errno = EFBIG;
+      return -1;
+    }
+    memcpy(file.data.data() + offset, buf, count);
+    file.dirty = true;
+    return count;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "file_pwrite: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
 }
 
 static int file_getdents64(
@@ -167,40 +271,60 @@ static int file_fstat(oe_fd_t* desc, struct oe_stat_t* buf) {
   static_assert(sizeof_oe_stat < sizeof st);
   memset(&st, 0, sizeof_oe_stat);
 
+  auto& file = *reinterpret_cast<File*>(desc)->file;
+  const lock_guard lock(file.mutex);
+  st.st_size = file.Content().size();
+  return 0;
+}
+
+static int file_ftruncate(oe_fd_t* desc, oe_off_t length) {
+  if (length < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
   try {
-    auto& file = *reinterpret_cast<File*>(desc);
-    const lock_guard lock(file.mut);
-    st.st_size = file.handler->Size(file.path);
+    auto& file = *reinterpret_cast<File*>(desc)->file;
+    const lock_guard lock(file.mutex);
+    if (file.Content().size() != static_cast<size_t>(length)) {
+      Materialize(file);
+      file.data.resize(length);
+      file.dirty = true;
+    }
   } catch (const exception& ex) {
-    oe_log(OE_LOG_LEVEL_ERROR, "file_fstat: %s\n", ex.what());
+    oe_log(OE_LOG_LEVEL_ERROR, "file_ftruncate: %s\n", ex.what());
     errno = EIO;
     return -1;
   }
-
   return 0;
 }
 
-static int file_ftruncate(oe_fd_t* /*desc*/, oe_off_t /*length*/) {
-  errno = ENOSYS;
-  return -1;
-}
-
-static int file_fsync(oe_fd_t* /*desc*/) {
+static int file_fsync(oe_fd_t* desc) {
+  try {
+    auto& fd = *reinterpret_cast<File*>(desc);
+    fd.handler->Flush(fd.file, false);
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "file_fsync: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
   return 0;
 }
 
-int edb::RedirectOpenFile(std::string_view path, SyscallHandler* handler) {
-  assert(!path.empty());
+int edb::RedirectOpenFile(std::shared_ptr<OpenFile> file, SyscallHandler* handler) {
+  assert(file);
   assert(handler);
 
-  auto file = make_unique<File>();
-  file->base.type = OE_FD_TYPE_FILE;
-  file->path = path;
-  file->handler = handler;
+  auto fd = make_unique<File>();
+  fd->base.type = OE_FD_TYPE_FILE;
+  fd->file = move(file);
+  fd->handler = handler;
 
-  auto& ops = file->base.ops;
+  auto& ops = fd->base.ops;
   ops.fd.read = file_read;
   ops.fd.write = file_write;
+  ops.fd.readv = file_readv;
+  ops.fd.writev = file_writev;
   ops.fd.dup = file_dup;
   ops.fd.ioctl = file_ioctl;
   ops.fd.fcntl = file_fcntl;
@@ -215,10 +339,11 @@ int edb::RedirectOpenFile(std::string_view path, SyscallHandler* handler) {
   ops.file.fsync = file_fsync;
   ops.file.fdatasync = file_fsync;
 
-  const int fd = fdtable_assign(&file->base);
-  if (fd < 0)
+  const int res = fdtable_assign(&fd->base);
+  if (res < 0)
     return -1;
 
-  (void)file.release();
-  return fd;
+  (void)fd.release();
+  metrics::files_opened.Add();
+  return res;
 }
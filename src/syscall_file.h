@@ -15,13 +15,32 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
 
+#include "store.h"
 #include "syscall_handler.h"
 
 namespace edb {
 
-// Opens a file in the enclave runtime and redirects operations on it to handler. Returns an fd.
-int RedirectOpenFile(std::string_view path, SyscallHandler* handler);
+// The content of a file backed by the store while it is open. All fds of the file share it, so they see each other's
+// writes. It is initialized with pinned, which may be nullptr for an empty file. Reads are served from pinned without
+// copying it. The first modification copies it to data, which SyscallHandler::Flush writes back on fsync and close.
+struct OpenFile {
+  std::mutex mutex;
+  std::string path;  // empty if the file has been unlinked or replaced; only changed with the key mutex held, too
+  Store::PinnedValuePtr pinned;
+  std::string data;
+  bool dirty = false;
+
+  std::string_view Content() const noexcept {
+    return pinned ? pinned->Data() : data;
+  }
+};
+
+// Opens a file in the enclave runtime that reads and writes file. Returns an fd.
+int RedirectOpenFile(std::shared_ptr<OpenFile> file, SyscallHandler* handler);
 
 }  // namespace edb
@@ -21,20 +21,19 @@
 
 #include <cassert>
 #include <cerrno>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
-#include <regex>
 #include <stdexcept>
 #include <string>
 
+#include "path.h"
 #include "syscall_file.h"
+#include "temp_file.h"
 
 using namespace std;
 using namespace edb;
 
-static const regex re_folder(R"(\./[^./]+/?)");
-static const regex re_path_to_known_file(R"(\./[^./]+/(db\.opt|[^./]+\.frm))");
-static const regex re_path_to_temp_frm_file(R"(\./[^./]+/[^./]+\.frm~)");
 static constexpr string_view temp_frm_ext = ".frm~";
 
 static bool StrEndsWith(string_view str, string_view suffix) {
@@ -45,6 +44,36 @@ static bool IsKnownExtension(string_view path) {
   return StrEndsWith(path, ".frm") || StrEndsWith(path, ".opt");
 }
 
+// Returns the last 4 chars of str as an int so that suffixes can be compared with a single branch.
+static constexpr uint32_t Suffix4(string_view str) noexcept {
+  if (str.size() < 4)
+    return 0;
+  str.remove_prefix(str.size() - 4);
+  return static_cast<uint32_t>(static_cast<unsigned char>(str[0])) |
+         static_cast<uint32_t>(static_cast<unsigned char>(str[1])) << 8 |
+         static_cast<uint32_t>(static_cast<unsigned char>(str[2])) << 16 |
+         static_cast<uint32_t>(static_cast<unsigned char>(str[3])) << 24;
+}
+
+static constexpr uint32_t kSuffixFrm = Suffix4(".frm");
+static constexpr uint32_t kSuffixOpt = Suffix4(".opt");
+static constexpr uint32_t kSuffixTempFrm = Suffix4("frm~");
+
+static uint32_t PathSuffix4(const char* path) noexcept {
+  return path ? Suffix4(path) : 0;
+}
+
+static bool HasKnownSuffix(const char* path) noexcept {
+  const uint32_t suffix = PathSuffix4(path);
+  return suffix == kSuffixFrm || suffix == kSuffixOpt;
+}
+
+static bool IsTempDir(string_view path) {
+  if (!path.empty() && path.back() == '/')
+    path.remove_suffix(1);
+  return path == kTempDir;
+}
+
 static string_view GetCf(string_view path) {
   if (StrEndsWith(path, ".frm"))
     return kCfNameFrm;
@@ -98,108 +127,139 @@ std::optional<int> SyscallHandler::Syscall(long number, long x1, long x2) {
   }
 }
 
-std::vector<std::string> SyscallHandler::Dir(std::string_view pathname) const {
+bool SyscallHandler::MayHandle(long number, long x1, long x2) noexcept {
+  const auto path = reinterpret_cast<const char*>(x1);
+  switch (number) {
+    case SYS_open: {
+      const uint32_t suffix = PathSuffix4(path);
+      return suffix == kSuffixFrm || suffix == kSuffixOpt || suffix == kSuffixTempFrm || (x2 & O_TMPFILE) == O_TMPFILE;
+    }
+    case SYS_stat:
+    case SYS_unlink:
+      return HasKnownSuffix(path);
+    case SYS_access:
+      return HasKnownSuffix(path) || (path && ParsePath(path).kind == PathKind::kFolder);
+    case SYS_rename: {
+      const uint32_t suffix = PathSuffix4(path);
+      return (suffix == kSuffixFrm && PathSuffix4(reinterpret_cast<const char*>(x2)) == kSuffixFrm) || suffix == kSuffixTempFrm;
+    }
+    default:
+      return false;
+  }
+}
+
+void SyscallHandler::Dir(std::string_view pathname, const std::function<void(std::string_view name)>& f) const {
   const string path = NormalizePath(pathname);
 
   const bool is_db = path == ".";
-  if (!is_db && !regex_match(path.cbegin(), path.cend(), re_folder))
+  if (!is_db && ParsePath(path).kind != PathKind::kFolder)
     throw invalid_argument("unexpected path");
 
-  vector<string> result;
-
-  {
-    const lock_guard lock(mutex_);
-    if (is_db)
-      result = store_->GetKeys(kCfNameDb, {});
-    else
-      result = store_->GetKeys(kCfNameFrm, path);
-  }
-
   if (is_db)
-    for (auto& x : result) {
-      x.erase(x.rfind('/'));  // remove /db.opt
-      x.erase(0, 2);          // remove ./
-    }
+    store_->ForEachKey(kCfNameDb, {}, [&f](string_view key) {
+      // ./db/db.opt -> db
+      const size_t slash = key.rfind('/');
+      f(key.substr(2, slash - 2));
+    });
   else
-    for (auto& x : result)
-      x.erase(0, x.rfind('/') + 1);  // remove path before filename
-
-  return result;
+    store_->ForEachKey(kCfNameFrm, path, [&f](string_view key) {
+      // remove path before filename
+      f(key.substr(key.rfind('/') + 1));
+    });
 }
 
-size_t SyscallHandler::Read(std::string_view path, void* buf, size_t count, size_t offset) const {
-  const string_view cf = GetCf(path);
-  optional<string> value;
-
-  {
-    const lock_guard lock(mutex_);
-    value = store_->Get(cf, path);
+void SyscallHandler::Flush(const std::shared_ptr<OpenFile>& file, bool closing) {
+  for (;;) {
+    string path;
+    {
+      const lock_guard lock(file->mutex);
+      path = file->path;
+    }
+    if (path.empty())
+      return;
+
+    KeyShard& shard = Shard(path);
+    const lock_guard shard_lock(shard.mutex);
+    const lock_guard lock(file->mutex);
+    // the file may have been renamed or detached in the meantime
+    if (file->path != path)
+      continue;
+    if (file->dirty) {
+      store_->Put(GetCf(path), path, file->Content());
+      file->dirty = false;
+    }
+    // other fds can only get the file from the shard, which is locked
+    if (closing && file.use_count() == 1)
+      shard.open_files.erase(path);
+    return;
   }
-
-  if (!value)
-    throw logic_error("not found");
-
-  if (value->size() <= offset)
-    return 0;
-
-  count = min(count, value->size() - offset);
-  memcpy(buf, value->data() + offset, count);
-  return count;
-}
-
-void SyscallHandler::Write(std::string_view path, std::string_view buf, size_t offset) {
-  const string_view cf = GetCf(path);
-
-  const lock_guard lock(mutex_);
-
-  string value = store_->Get(cf, path).value_or(string());
-
-  const size_t required_size = offset + buf.size();
-  if (required_size < offset)
-    throw overflow_error("write offset overflow");
-  if (value.size() < required_size)
-    value.resize(required_size);
-
-  memcpy(value.data() + offset, buf.data(), buf.size());
-
-  store_->Put(cf, path, value);
-}
-
-size_t SyscallHandler::Size(std::string_view path) const {
-  const string_view cf = GetCf(path);
-  const lock_guard lock(mutex_);
-  return store_->Get(cf, path).value_or(string()).size();
 }
 
 std::optional<int> SyscallHandler::Open(const char* pathname, int flags) {
   assert(pathname && *pathname);
+
+  if ((flags & O_TMPFILE) == O_TMPFILE) {
+    if (!IsTempDir(pathname))
+      return {};
+    return OpenTempFile();
+  }
+
   const string path = NormalizePath(pathname);
 
   if (!IsKnownExtension(path)) {
     // if it's a temporary frm file, make sure the directory exists
     if (StrEndsWith(path, temp_frm_ext)) {
-      if (!regex_match(path.cbegin(), path.cend(), re_path_to_temp_frm_file))
+      if (ParsePath(path).kind != PathKind::kTempFrm)
         throw invalid_argument("unexpected pathname");
       mkdir(string(path, 0, path.rfind('/')).c_str(), 0777);
     }
     return {};
   }
 
-  if (!regex_match(path.cbegin(), path.cend(), re_path_to_known_file))
+  if (!IsKnownFile(ParsePath(path)))
     throw invalid_argument("unexpected pathname");
 
-  if (!(flags & O_CREAT) && !Exists(path)) {
-    errno = ENOENT;
-    return -1;
+  // The file is loaded once and then served from memory until its last fd is closed.
+  KeyShard& shard = Shard(path);
+  unique_lock lock(shard.mutex);
+  auto file = FindOpenFile(shard, path);
+  if (!file) {
+    lock.unlock();
+    auto value = store_->GetPinned(GetCf(path), path);
+
+    if (!(flags & O_CREAT) && !value) {
+      errno = ENOENT;
+      return -1;
+    }
+
+    // don't create .frm file if db doesn't exist
+    if (StrEndsWith(path, ".frm") && !Exists(string(path, 0, path.rfind('/') + 1) + "db.opt")) {
+      errno = ENOENT;
+      return -1;
+    }
+
+    lock.lock();
+    // another thread may have opened the file in the meantime
+    file = FindOpenFile(shard, path);
+    if (!file) {
+      file = make_shared<OpenFile>();
+      file->path = path;
+      file->pinned = move(value);
+      shard.open_files.insert_or_assign(path, file);
+    }
   }
 
-  // don't create .frm file if db doesn't exist
-  if (StrEndsWith(path, ".frm") && !Exists(string(path, 0, path.rfind('/') + 1) + "db.opt")) {
-    errno = ENOENT;
-    return -1;
+  if (flags & O_TRUNC) {
+    const lock_guard file_lock(file->mutex);
+    file->pinned.reset();
+    file->data.clear();
+    file->dirty = true;
   }
 
-  return RedirectOpenFile(path, this);
+  const int fd = RedirectOpenFile(file, this);
+  if (fd < 0 && file.use_count() == 1)
+    shard.open_files.erase(path);
+  return fd;
 }
 
 std::optional<int> SyscallHandler::Stat(const char* pathname, long statbuf) const {
@@ -209,16 +269,10 @@ std::optional<int> SyscallHandler::Stat(const char* pathname, long statbuf) cons
   const string_view path = pathname;
   if (!IsKnownExtension(path))
     return {};
-  if (!regex_match(path.cbegin(), path.cend(), re_path_to_known_file))
+  if (!IsKnownFile(ParsePath(path)))
     throw invalid_argument("unexpected pathname");
 
-  const string_view cf = GetCf(path);
-  optional<string> value;
-
-  {
-    const lock_guard lock(mutex_);
-    value = store_->Get(cf, path);
-  }
+  const auto value = store_->GetPinned(GetCf(path), path);
 
   if (!value) {
     errno = ENOENT;
@@ -227,27 +281,28 @@ std::optional<int> SyscallHandler::Stat(const char* pathname, long statbuf) cons
 
   auto& st = *reinterpret_cast<struct stat*>(statbuf);
   memset(&st, 0, sizeof st);
-  st.st_size = value->size();
+  st.st_size = value->Data().size();
   return 0;
 }
 
 std::optional<int> SyscallHandler::Access(const char* pathname) const {
   assert(pathname && *pathname);
 
-  string path = pathname;
-  const bool known_ext = IsKnownExtension(path);
+  const string_view pathname_view = pathname;
+  const bool known_ext = IsKnownExtension(pathname_view);
+  const PathInfo info = ParsePath(pathname_view);
+  string path;
 
   if (known_ext) {
-    if (!regex_match(path.cbegin(), path.cend(), re_path_to_known_file)) {
-      path.insert(0, "./");
-      if (!regex_match(path.cbegin(), path.cend(), re_path_to_known_file))
-        throw invalid_argument("unexpected pathname");
-    }
-  } else if (regex_match(path.cbegin(), path.cend(), re_folder)) {
+    if (IsKnownFile(info))
+      path = pathname_view;
+    else if (IsKnownFile(ParseRelativePath(pathname_view)))
+      path = "./" + string(pathname_view);
+    else
+      throw invalid_argument("unexpected pathname");
+  } else if (info.kind == PathKind::kFolder) {
     // It might be a db folder. Check if db.opt exists.
-    if (path.back() != '/')
-      path += '/';
-    path += "db.opt";
+    path = "./" + string(info.db) + "/db.opt";
   } else
     return {};
 
@@ -262,25 +317,60 @@ std::optional<int> SyscallHandler::Access(const char* pathname) const {
 
 std::optional<int> SyscallHandler::Rename(const char* oldpath, const char* newpath) {
   if (StrEndsWith(oldpath, ".frm") && StrEndsWith(newpath, ".frm")) {
-    if (!regex_match(oldpath, re_path_to_known_file))
+    if (!IsKnownFile(ParsePath(oldpath)))
       throw invalid_argument("unexpected oldpath");
-    if (!regex_match(newpath, re_path_to_known_file))
+    if (!IsKnownFile(ParsePath(newpath)))
       throw invalid_argument("unexpected newpath");
 
     // both old and new are in the store
-    const lock_guard lock(mutex_);
-    const auto value = store_->Get(kCfNameFrm, oldpath);
-    store_->Put(kCfNameFrm, newpath, value.value());
-    store_->Delete(kCfNameFrm, oldpath);
+    KeyShard& old_shard = Shard(oldpath);
+    KeyShard& new_shard = Shard(newpath);
+    unique_lock old_lock(old_shard.mutex, defer_lock);
+    unique_lock new_lock(new_shard.mutex, defer_lock);
+    if (&old_shard == &new_shard)
+      old_lock.lock();
+    else
+      lock(old_lock, new_lock);
+
+    // An open file moves to newpath. If it has unflushed writes, these are the content of the file.
+    const auto file = FindOpenFile(old_shard, oldpath);
+    DetachOpenFile(new_shard, newpath);
+    unique_lock<mutex> file_lock;
+    if (file)
+      file_lock = unique_lock(file->mutex);
+
+    Store::PinnedValuePtr value;
+    string_view content;
+    if (file && file->dirty)
+      content = file->Content();
+    else {
+      value = store_->GetPinned(kCfNameFrm, oldpath);
+      if (!value)
+        throw logic_error("rename: oldpath not found");
+      content = value->Data();
+    }
+    Store::WriteBatch batch;
+    batch.Put(kCfNameFrm, newpath, content);
+    batch.Delete(kCfNameFrm, oldpath);
+    store_->Write(batch);
+
+    if (file) {
+      file->path = newpath;
+      file->dirty = false;
+      old_shard.open_files.erase(oldpath);
+      new_shard.open_files.insert_or_assign(newpath, file);
+    }
     return 0;
   }
 
   if (StrEndsWith(oldpath, temp_frm_ext)) {
-    if (!regex_match(newpath, re_path_to_known_file))
+    if (!IsKnownFile(ParsePath(newpath)))
       throw invalid_argument("unexpected newpath");
 
     // temp frm files are in memfs and should be moved into the store
-    const lock_guard lock(mutex_);
+    KeyShard& shard = Shard(newpath);
+    const lock_guard lock(shard.mutex);
+    DetachOpenFile(shard, newpath);
     store_->Put(kCfNameFrm, newpath, ReadFile(oldpath));
     remove(oldpath);
     return 0;
@@ -298,13 +388,34 @@ std::optional<int> SyscallHandler::Unlink(const char* pathname) {
 
   const string_view cf = GetCf(path);
 
-  const lock_guard lock(mutex_);
+  KeyShard& shard = Shard(path);
+  const lock_guard lock(shard.mutex);
+  DetachOpenFile(shard, path);
   store_->Delete(cf, path);
   return 0;
 }
 
 bool SyscallHandler::Exists(std::string_view path) const {
-  const string_view cf = GetCf(path);
-  const lock_guard lock(mutex_);
-  return store_->Get(cf, path).has_value();
+  return store_->GetPinned(GetCf(path), path) != nullptr;
+}
+
+SyscallHandler::KeyShard& SyscallHandler::Shard(std::string_view path) {
+  return key_shards_[hash<string_view>()(path) % kNumKeyShards];
+}
+
+std::shared_ptr<OpenFile> SyscallHandler::FindOpenFile(const KeyShard& shard, std::string_view path) {
+  const auto it = shard.open_files.find(path);
+  return it == shard.open_files.cend() ? nullptr : it->second.lock();
+}
+
+void SyscallHandler::DetachOpenFile(KeyShard& shard, std::string_view path) {
+  const auto it = shard.open_files.find(path);
+  if (it == shard.open_files.end())
+    return;
+  if (const auto file = it->second.lock()) {
+    const lock_guard lock(file->mutex);
+    file->path.clear();
+    file->dirty = false;
+  }
+  shard.open_files.erase(it);
 }
@@ -15,8 +15,13 @@
 
 #pragma once
 
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
+#include <string>
 #include <string_view>
 
 #include "store.h"
@@ -26,12 +31,21 @@ namespace edb {
 constexpr std::string_view kCfNameFrm = "edg_frm_cf";
 constexpr std::string_view kCfNameDb = "edg_db_cf";
 
+struct OpenFile;
+
 /*
 SyscallHandler intercepts filesystem calls and redirects .frm and db.opt files to the store.
 
 MariaDB would usually write different types of files to its data directory. We mount this directory
 in memfs for security, excluding the encrypted RocksDB files. However, .frm and db.opt files need
 to be persistent. To achieve this, we intercept access to them and store them in RocksDB.
+
+Anonymous temp files opened with O_TMPFILE in kTempDir are created by OpenTempFile, see temp_file.h.
+
+Reads go to the store without locking. Writes lock the keys they modify so that only writes to the same key serialize.
+
+While a file is open, its content is buffered in an OpenFile that all of its fds share. The OpenFile is registered
+under the key mutex, so a rename moves it to the new key, and unlinking or replacing its key detaches it.
 */
 class SyscallHandler final {
  public:
@@ -40,13 +54,16 @@ class SyscallHandler final {
   // Returns an int if the syscall was handled; otherwise, returns none.
   std::optional<int> Syscall(long number, long x1, long x2);
 
-  // Returns the directory contents backed by the store.
-  std::vector<std::string> Dir(std::string_view pathname) const;
+  // Returns false if Syscall will not handle the syscall. This is checked before Syscall for every syscall in the
+  // enclave, so it must be cheap and must not allocate.
+  static bool MayHandle(long number, long x1, long x2) noexcept;
+
+  // Calls f for each directory entry backed by the store. The name is only valid during the call.
+  void Dir(std::string_view pathname, const std::function<void(std::string_view name)>& f) const;
 
-  // These are called for open files backed by the store.
-  size_t Read(std::string_view path, void* buf, size_t count, size_t offset) const;
-  void Write(std::string_view path, std::string_view buf, size_t offset);
-  size_t Size(std::string_view path) const;
+  // Writes the content of an open file back to the store if it has been modified. If closing is true, the fd of file
+  // is about to be closed, so the file is unregistered if this is its last fd.
+  void Flush(const std::shared_ptr<OpenFile>& file, bool closing);
 
  private:
   std::optional<int> Open(const char* pathname, int flags);
@@ -56,8 +73,20 @@ class SyscallHandler final {
   std::optional<int> Unlink(const char* pathname);
   bool Exists(std::string_view path) const;
 
+  // Keys are mapped to a fixed set of shards. The mutex guards writes to the keys and the open files of the shard.
+  struct KeyShard {
+    std::mutex mutex;
+    std::map<std::string, std::weak_ptr<OpenFile>, std::less<>> open_files;
+  };
+  KeyShard& Shard(std::string_view path);
+  // Returns the open file of path or nullptr. Must be called with shard.mutex held.
+  static std::shared_ptr<OpenFile> FindOpenFile(const KeyShard& shard, std::string_view path);
+  // Detaches the open file of path, if any, so that it is no longer written back. Must be called with shard.mutex held.
+  static void DetachOpenFile(KeyShard& shard, std::string_view path);
+
   StorePtr store_;
-  mutable std::mutex mutex_;
+  static constexpr size_t kNumKeyShards = 64;
+  std::array<KeyShard, kNumKeyShards> key_shards_;
 };
 
 }  // namespace edb
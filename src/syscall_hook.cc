@@ -18,22 +18,156 @@ typedef unsigned long myf;
 
 #include <my_dir.h>
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <exception>
 #include <memory>
-
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "cached_store.h"
+#include "compressed_store.h"
+#include "metrics.h"
 #include "oe_internal.h"
+#include "query_cache_stats.h"
 #include "rocksdb.h"
 #include "syscall_handler.h"
+#include "temp_file.h"
 
 using namespace std;
 using namespace edb;
 
-static SyscallHandler handler(make_shared<RocksDB>());
+#ifndef EDB_NUM_TCS
+#error EDB_NUM_TCS must be defined to the NumTCS of enclave.conf
+#endif
+
+static const auto store = make_shared<CachedStore>(make_shared<CompressedStore>(make_shared<RocksDB>()), kDefaultMetadataCacheSize);
+static SyscallHandler handler(store);
+
+extern "C" void edgeless_set_metadata_cache_size(size_t size) {
+  store->SetCapacity(size);
+}
+
+// Loads the db.opt and .frm files into the metadata cache. The .frm files are scanned by database with up to num_threads
+// threads.
+extern "C" void edgeless_prefetch_metadata(size_t num_threads) {
+  try {
+    vector<string> databases;
+    store->ForEachKey(kCfNameDb, {}, [&databases](string_view key) {
+      // ./db/db.opt -> ./db/
+      databases.emplace_back(key.substr(0, key.rfind('/') + 1));
+    });
+    store->Prefetch(kCfNameDb, {""}, 1);
+    store->Prefetch(kCfNameFrm, databases, num_threads);
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "prefetch_metadata: %s\n", ex.what());
+  }
+}
+
+// Creates a checkpoint of RocksDB in dir for a backup. Returns 0 on success and -1 on error.
+extern "C" int edgeless_create_checkpoint(const char* dir) {
+  assert(dir && *dir);
+  try {
+    RocksDB::CreateCheckpoint(dir);
+    return 0;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "create_checkpoint: %s\n", ex.what());
+    return -1;
+  }
+}
+
+// Lets temp files that would exceed threshold bytes of enclave memory spill to encrypted files in dir.
+extern "C" void edgeless_set_temp_spill(const char* dir, size_t threshold) {
+  assert(dir && *dir);
+  SetTempFileSpill(dir, threshold);
+}
+
+// Returns the number of thread slots of the enclave.
+extern "C" size_t edgeless_get_num_tcs() {
+  return EDB_NUM_TCS;
+}
+
+namespace {
+// Counts the threads that have used the syscall hook and have not exited yet. Each of them occupies a TCS.
+struct ThreadCounter {
+  static inline atomic<uint64_t> threads;
+
+  ThreadCounter() noexcept {
+    ++threads;
+  }
+  ~ThreadCounter() {
+    --threads;
+  }
+};
+}  // namespace
+
+static thread_local const ThreadCounter thread_counter;
+
+// Copies the syscall counters for the syscall numbers [0, count) into the arrays.
+extern "C" void edgeless_get_syscall_counters(uint64_t* intercepted, uint64_t* handled, size_t count) {
+  assert(intercepted && handled);
+  count = min(count, metrics::kMaxSyscall);
+  for (size_t i = 0; i < count; ++i) {
+    intercepted[i] = metrics::syscalls_intercepted.Get(i);
+    handled[i] = metrics::syscalls_handled.Get(i);
+  }
+}
+
+// Returns all metrics in the Prometheus text format. The caller must free the string.
+extern "C" char* edgeless_get_metrics() {
+  try {
+    string text = metrics::Render();
+    const auto stats = store->GetStats();
+    metrics::RenderCounter(text, "edb_metadata_cache_hits_total", "Metadata cache hits.", stats.hits);
+    metrics::RenderCounter(text, "edb_metadata_cache_misses_total", "Metadata cache misses.", stats.misses);
+    metrics::RenderCounter(text, "edb_metadata_cache_evictions_total", "Metadata cache evictions.", stats.evictions);
+    metrics::RenderGauge(text, "edb_metadata_cache_size_bytes", "Memory used by the metadata cache.", stats.size);
+    metrics::RenderGauge(text, "edb_metadata_cache_capacity_bytes", "Memory budget of the metadata cache.", stats.capacity);
+    const auto temp = GetTempFileStats();
+    metrics::RenderGauge(text, "edb_temp_files", "Open temp files.", temp.files);
+    metrics::RenderGauge(text, "edb_temp_memory_bytes", "Enclave memory used by temp files.", temp.memory_size);
+    metrics::RenderGauge(text, "edb_temp_spilled_bytes", "Size of temp files that have been spilled to the host.", temp.spilled_size);
+    metrics::RenderCounter(text, "edb_temp_spilled_files_total", "Temp files that have been spilled to the host.", temp.spilled_files);
+    metrics::RenderGauge(text, "edb_enclave_threads", "Enclave threads, each occupies a TCS.", ThreadCounter::threads);
+    metrics::RenderGauge(text, "edb_enclave_tcs", "Thread slots of the enclave (NumTCS).", EDB_NUM_TCS);
+    metrics::RenderGauge(text, "edb_heap_size_bytes", "Size of the enclave heap.", __oe_get_heap_size());
+    // The allocator may not support stats. The difference between system and in-use bytes is memory that is held by the
+    // allocator but not allocated, e.g., in thread caches or fragments.
+    if (oe_malloc_stats_t heap{}; oe_get_malloc_stats(&heap) == OE_OK) {
+      metrics::RenderGauge(text, "edb_heap_system_bytes", "Enclave heap memory taken by the allocator.", heap.system_bytes);
+      metrics::RenderGauge(text, "edb_heap_peak_system_bytes", "Peak of edb_heap_system_bytes.", heap.peak_system_bytes);
+      metrics::RenderGauge(text, "edb_heap_in_use_bytes", "Enclave heap memory allocated by the application.", heap.in_use_bytes);
+    }
+    RocksDB::RenderMetrics(text);
+    EdgelessQueryCacheStats query_cache{};
+    edgeless_get_query_cache_stats(&query_cache);
+    metrics::RenderCounter(text, "edb_query_cache_hits_total", "Queries answered by the query cache.", query_cache.hits);
+    metrics::RenderCounter(text, "edb_query_cache_inserts_total", "Results added to the query cache.", query_cache.inserts);
+    metrics::RenderCounter(text, "edb_query_cache_not_cached_total", "Queries that could not be cached.", query_cache.not_cached);
+    metrics::RenderCounter(text, "edb_query_cache_lowmem_prunes_total", "Results evicted from the query cache for lack of memory.", query_cache.lowmem_prunes);
+    metrics::RenderGauge(text, "edb_query_cache_queries", "Results in the query cache.", query_cache.queries);
+    metrics::RenderGauge(text, "edb_query_cache_free_bytes", "Free memory of the query cache.", query_cache.free_memory);
+    return strdup(text.c_str());
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "get_metrics: %s\n", ex.what());
+    return nullptr;
+  }
+}
 
 extern "C" oe_result_t edgeless_syscall_hook(long number, long x1, long x2, long /*x3*/, long /*x4*/, long /*x5*/, long /*x6*/, long* ret) {
   assert(ret);
+  (void)&thread_counter;  // registers the thread on its first syscall
+
+  const bool count = 0 <= number && static_cast<size_t>(number) < metrics::kMaxSyscall;
+  if (count)
+    metrics::syscalls_intercepted.Add(number);
+
+  if (!SyscallHandler::MayHandle(number, x1, x2))
+    return OE_UNEXPECTED;
 
   try {
     const auto res = handler.Syscall(number, x1, x2);
@@ -46,6 +180,8 @@ extern "C" oe_result_t edgeless_syscall_hook(long number, long x1, long x2, long
     errno = EIO;
   }
 
+  if (count)
+    metrics::syscalls_handled.Add(number);
   return OE_OK;
 }
 
@@ -59,22 +195,39 @@ MY_DIR* edgeless_my_dir(const char* path, myf /*MyFlags*/) {
   }();
 
   try {
-    const auto subpaths = handler.Dir(path);
-    auto entries = make_unique<fileinfo[]>(subpaths.size());  // NOLINT
-    auto dir = make_unique<MY_DIR>();
-    dir->number_of_files = subpaths.size();
+    // collect the null-terminated names
+    string names;
+    size_t count = 0;
+    handler.Dir(path, [&names, &count](string_view name) {
+      names += name;
+      names += '\0';
+      ++count;
+    });
+
+    // MY_DIR, its entries, and the names are placed in a single allocation: [MY_DIR][fileinfo...][names]
+    static_assert(sizeof(MY_DIR) % alignof(fileinfo) == 0);
+    static_assert(is_trivially_destructible_v<MY_DIR> && is_trivially_destructible_v<fileinfo>);
+    const size_t entries_offset = sizeof(MY_DIR);
+    const size_t names_offset = entries_offset + count * sizeof(fileinfo);
+    char* const block = new char[names_offset + names.size()];
+
+    auto* const dir = new (block) MY_DIR{};
+    auto* const entries = reinterpret_cast<fileinfo*>(block + entries_offset);
+    uninitialized_value_construct_n(entries, count);
+    char* name = block + names_offset;
+    memcpy(name, names.data(), names.size());
 
     // fill entries
-    for (size_t i = 0; i < subpaths.size(); ++i) {
-      const auto& subpath = subpaths[i];
+    for (size_t i = 0; i < count; ++i) {
       auto& entry = entries[i];
       entry.mystat = &mystat;
-      entry.name = new char[subpath.size() + 1]();
-      memcpy(entry.name, subpath.data(), subpath.size());
+      entry.name = name;
+      name += strlen(name) + 1;
     }
 
-    dir->dir_entry = entries.release();
-    return dir.release();
+    dir->dir_entry = entries;
+    dir->number_of_files = count;
+    return dir;
   } catch (const exception& ex) {
     oe_log(OE_LOG_LEVEL_ERROR, "my_dir: %s\n", ex.what());
     return nullptr;
@@ -84,8 +237,6 @@ MY_DIR* edgeless_my_dir(const char* path, myf /*MyFlags*/) {
 void edgeless_my_dirend(MY_DIR* buffer) {
   assert(buffer);
   assert(buffer->dir_entry);
-  for (size_t i = 0; i < buffer->number_of_files; ++i)
-    delete[] buffer->dir_entry[i].name;
-  delete[] buffer->dir_entry;
-  delete buffer;
+  // MY_DIR and fileinfo are trivially destructible, so we only need to free the block allocated by edgeless_my_dir
+  delete[] reinterpret_cast<char*>(buffer);
 }
@@ -16,14 +16,23 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
+#include <unistd.h>
 
 #include <cstdarg>
 #include <functional>
 #include <iostream>
 #include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
+#include "cached_store.h"
+#include "compressed_store.h"
+#include "metrics.h"
 #include "oe_internal.h"
+#include "path.h"
 #include "syscall_handler.h"
+#include "temp_file.h"
 
 #define ASSERT(x) /*NOLINT*/                                       \
   if (!(x)) {                                                      \
@@ -40,8 +49,21 @@ extern function<decltype(oe_fdtable_assign)> fdtable_assign;
 }  // namespace edb
 
 namespace {
+struct StringValue final : Store::PinnedValue {
+  explicit StringValue(string value)
+      : value(move(value)) {
+  }
+
+  std::string_view Data() const noexcept override {
+    return value;
+  }
+
+  const string value;
+};
+
 struct FakeStore : Store {
   std::optional<std::string> Get(std::string_view column_family, std::string_view key) const override {
+    ++get_count;
     const auto it1 = data.find(column_family);
     if (it1 == data.cend())
       return {};
@@ -51,7 +73,15 @@ struct FakeStore : Store {
     return it2->second;
   }
 
+  PinnedValuePtr GetPinned(std::string_view column_family, std::string_view key) const override {
+    auto value = Get(column_family, key);
+    if (!value)
+      return nullptr;
+    return make_unique<StringValue>(move(*value));
+  }
+
   void Put(std::string_view column_family, std::string_view key, std::string_view value) override {
+    ++put_count;
     data[string(column_family)][string(key)] = value;
   }
 
@@ -59,15 +89,31 @@ struct FakeStore : Store {
     data.at(string(column_family)).erase(string(key));
   }
 
-  std::vector<std::string> GetKeys(std::string_view column_family, std::string_view prefix) const override {
-    vector<string> result;
+  void Write(const WriteBatch& batch) override {
+    ++write_count;
+    for (const auto& op : batch.Ops())
+      if (op.value)
+        data[op.column_family][op.key] = *op.value;
+      else
+        data.at(op.column_family).erase(op.key);
+  }
+
+  void ForEachKey(std::string_view column_family, std::string_view prefix, const std::function<void(std::string_view key)>& f) const override {
     for (const auto& [k, v] : data.at(string(column_family)))
       if (k.compare(0, prefix.size(), prefix) == 0)
-        result.push_back(k);
-    return result;
+        f(k);
+  }
+
+  void ForEach(std::string_view column_family, std::string_view prefix, const std::function<bool(std::string_view key, std::string_view value)>& f) const override {
+    for (const auto& [k, v] : data.at(string(column_family)))
+      if (k.compare(0, prefix.size(), prefix) == 0 && !f(k, v))
+        return;
   }
 
   map<string, map<string, string, less<>>, less<>> data;
+  mutable size_t get_count = 0;
+  size_t put_count = 0;
+  size_t write_count = 0;
 };
 }  // namespace
 
@@ -128,6 +174,174 @@ static void TestFile() {
   ASSERT(in == out);
 }
 
+static void TestFileBuffering() {
+  const auto path = "./foo/db.opt";
+  const string in(10000, 'a');
+
+  const auto store = make_shared<FakeStore>();
+  SyscallHandler handler(store);
+
+  oe_fd_t* file = nullptr;
+  fdtable_assign = [&file](oe_fd_t* desc) {
+    file = desc;
+    return 2;
+  };
+
+  // many small writes result in a single put on close
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>(path), O_CREAT));
+  for (size_t i = 0; i < in.size(); i += 100)
+    ASSERT(100 == file->ops.fd.write(file, in.data() + i, 100));
+  ASSERT(0 == store->put_count);
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT(1 == store->put_count);
+  ASSERT(in == store->Get(kCfNameDb, path));
+
+  // many small reads result in a single get on open
+  store->get_count = 0;
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>(path), 0));
+  string out(in.size() + 1, '\0');
+  for (size_t i = 0; i < in.size(); i += 100)
+    ASSERT(100 == file->ops.fd.read(file, out.data() + i, 100));
+  ASSERT(0 == file->ops.fd.read(file, out.data(), 1));
+  ASSERT(0 == file->ops.fd.close(file));
+  out.pop_back();
+  ASSERT(in == out);
+  ASSERT(1 == store->get_count);
+
+  // unmodified file is not written back
+  ASSERT(1 == store->put_count);
+
+  // fsync writes back the buffer
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>(path), 0));
+  ASSERT(static_cast<oe_off_t>(in.size()) == file->ops.file.lseek(file, 0, SEEK_END));
+  ASSERT(1 == file->ops.fd.write(file, "b", 1));
+  ASSERT(0 == file->ops.file.fsync(file));
+  ASSERT(2 == store->put_count);
+  ASSERT(in + 'b' == store->Get(kCfNameDb, path));
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT(2 == store->put_count);
+
+  // O_TRUNC discards the old content
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>(path), O_CREAT | O_TRUNC));
+  ASSERT(2 == file->ops.fd.write(file, "cc", 2));
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT("cc" == store->Get(kCfNameDb, path));
+}
+
+static void TestFilePositionalAndVectored() {
+  const auto path = "./foo/db.opt";
+
+  const auto store = make_shared<FakeStore>();
+  SyscallHandler handler(store);
+
+  oe_fd_t* file = nullptr;
+  fdtable_assign = [&file](oe_fd_t* desc) {
+    file = desc;
+    return 2;
+  };
+
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>(path), O_CREAT));
+
+  // writev appends all buffers at the current offset
+  string a = "foo", b = "", c = "barbaz";
+  const oe_iovec iov_in[] = {{a.data(), a.size()}, {b.data(), b.size()}, {c.data(), c.size()}};
+  ASSERT(9 == file->ops.fd.writev(file, iov_in, 3));
+
+  // pwrite doesn't change the offset and may extend the file
+  ASSERT(3 == file->ops.file.pwrite(file, "qux", 3, 12));
+  ASSERT(3 == file->ops.fd.write(file, "123", 3));
+
+  // pread doesn't change the offset
+  string out(16, '\0');
+  ASSERT(15 == file->ops.file.pread(file, out.data(), out.size(), 0));
+  ASSERT(string("foobarbaz123qux\0", 16) == out);
+  ASSERT(5 == file->ops.file.pread(file, out.data(), 5, 10));
+  ASSERT("23qux" == out.substr(0, 5));
+  ASSERT(0 == file->ops.file.pread(file, out.data(), out.size(), 15));
+  ASSERT(-1 == file->ops.file.pread(file, out.data(), out.size(), -1));
+  ASSERT(EINVAL == errno);
+  ASSERT(12 == file->ops.file.lseek(file, 0, SEEK_CUR));
+
+  // readv fills the buffers in order and stops at the end of the file
+  ASSERT(0 == file->ops.file.lseek(file, 0, SEEK_SET));
+  string x(4, '\0'), y(4, '\0'), z(10, '\0');
+  const oe_iovec iov_out[] = {{x.data(), x.size()}, {y.data(), y.size()}, {z.data(), z.size()}};
+  ASSERT(15 == file->ops.fd.readv(file, iov_out, 3));
+  ASSERT("foob" == x);
+  ASSERT("arba" == y);
+  ASSERT("z123qux" == z.substr(0, 7));
+  ASSERT(0 == file->ops.fd.readv(file, iov_out, 3));
+
+  // ftruncate shrinks and extends the file
+  ASSERT(0 == file->ops.file.ftruncate(file, 6));
+  ASSERT(0 == file->ops.file.fsync(file));
+  ASSERT("foobar" == store->Get(kCfNameDb, path));
+  ASSERT(0 == file->ops.file.ftruncate(file, 8));
+  ASSERT(-1 == file->ops.file.ftruncate(file, -1));
+  ASSERT(EINVAL == errno);
+
+  // all of this has been a single put for fsync and a single put for close
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT(2 == store->put_count);
+  ASSERT(string("foobar\0\0", 8) == store->Get(kCfNameDb, path));
+}
+
+static void TestFileSharing() {
+  const auto store = make_shared<FakeStore>();
+  store->Put(kCfNameDb, "./mydb/db.opt", {});
+  SyscallHandler handler(store);
+
+  vector<oe_fd_t*> files;
+  fdtable_assign = [&files](oe_fd_t* desc) {
+    files.push_back(desc);
+    return static_cast<int>(files.size() + 2);
+  };
+  const auto my_open = [&handler](const char* path, int flags) {
+    return handler.Syscall(SYS_open, reinterpret_cast<long>(path), flags);
+  };
+
+  // two fds of the same file see each other's writes and the last close doesn't discard the writes of the other
+  ASSERT(3 == my_open("./mydb/t1.frm", O_CREAT));
+  ASSERT(4 == my_open("./mydb/t1.frm", O_CREAT));
+  ASSERT(3 == files[0]->ops.file.pwrite(files[0], "foo", 3, 0));
+  ASSERT(3 == files[1]->ops.file.pwrite(files[1], "bar", 3, 3));
+  string out(6, '\0');
+  ASSERT(6 == files[1]->ops.file.pread(files[1], out.data(), out.size(), 0));
+  ASSERT("foobar" == out);
+  ASSERT(0 == files[0]->ops.fd.close(files[0]));
+  ASSERT("foobar" == store->Get(kCfNameFrm, "./mydb/t1.frm"));
+  ASSERT(0 == files[1]->ops.fd.close(files[1]));
+  ASSERT("foobar" == store->Get(kCfNameFrm, "./mydb/t1.frm"));
+  files.clear();
+
+  // a file that is renamed while it has unflushed writes keeps them and isn't written back to the old key
+  ASSERT(3 == my_open("./mydb/t1.frm", 0));
+  ASSERT(3 == files[0]->ops.fd.write(files[0], "baz", 3));
+  ASSERT(0 == handler.Syscall(SYS_rename, reinterpret_cast<long>("./mydb/t1.frm"), reinterpret_cast<long>("./mydb/t2.frm")));
+  ASSERT("bazbar" == store->Get(kCfNameFrm, "./mydb/t2.frm"));
+  ASSERT(3 == files[0]->ops.fd.write(files[0], "qux", 3));
+  ASSERT(0 == files[0]->ops.fd.close(files[0]));
+  ASSERT(!store->Get(kCfNameFrm, "./mydb/t1.frm"));
+  ASSERT("bazqux" == store->Get(kCfNameFrm, "./mydb/t2.frm"));
+  files.clear();
+
+  // a file that is unlinked or replaced while it is open isn't written back
+  ASSERT(3 == my_open("./mydb/t2.frm", 0));
+  ASSERT(3 == files[0]->ops.fd.write(files[0], "abc", 3));
+  ASSERT(0 == handler.Syscall(SYS_unlink, reinterpret_cast<long>("./mydb/t2.frm"), 0));
+  ASSERT(0 == files[0]->ops.fd.close(files[0]));
+  ASSERT(!store->Get(kCfNameFrm, "./mydb/t2.frm"));
+  files.clear();
+
+  store->Put(kCfNameFrm, "./mydb/t1.frm", "old");
+  store->Put(kCfNameFrm, "./mydb/t2.frm", "new");
+  ASSERT(3 == my_open("./mydb/t1.frm", 0));
+  ASSERT(3 == files[0]->ops.fd.write(files[0], "abc", 3));
+  ASSERT(0 == handler.Syscall(SYS_rename, reinterpret_cast<long>("./mydb/t2.frm"), reinterpret_cast<long>("./mydb/t1.frm")));
+  ASSERT(0 == files[0]->ops.fd.close(files[0]));
+  ASSERT("new" == store->Get(kCfNameFrm, "./mydb/t1.frm"));
+}
+
 static void TestOpenError() {
   const auto store = make_shared<FakeStore>();
   SyscallHandler handler(store);
@@ -196,6 +410,10 @@ static void TestRename() {
   ASSERT(0 == my_rename("./mydb/oldname.frm", "./mydb/newname.frm"));
   ASSERT(!store->Get(kCfNameFrm, "./mydb/oldname.frm"));
   ASSERT("foo" == store->Get(kCfNameFrm, "./mydb/newname.frm"));
+
+  // the rename is a single atomic write
+  ASSERT(1 == store->put_count);
+  ASSERT(1 == store->write_count);
 }
 
 static void TestUnlink() {
@@ -221,23 +439,421 @@ static void TestDir() {
   store->Put(kCfNameFrm, "./mydb/bar.frm", {});
   const SyscallHandler handler(store);
 
-  ASSERT(vector<string>{"mydb"} == handler.Dir("."));
-  ASSERT(vector<string>{"mydb"} == handler.Dir("/data/"));
-  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == handler.Dir("./mydb"));
-  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == handler.Dir("./mydb/"));
-  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == handler.Dir("/data/mydb"));
-  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == handler.Dir("/data/mydb/"));
-  ASSERT(handler.Dir("./otherdb").empty());
+  const auto dir = [&handler](string_view path) {
+    vector<string> result;
+    handler.Dir(path, [&result](string_view name) { result.emplace_back(name); });
+    return result;
+  };
+
+  ASSERT(vector<string>{"mydb"} == dir("."));
+  ASSERT(vector<string>{"mydb"} == dir("/data/"));
+  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == dir("./mydb"));
+  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == dir("./mydb/"));
+  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == dir("/data/mydb"));
+  ASSERT((vector<string>{"bar.frm", "foo.frm"}) == dir("/data/mydb/"));
+  ASSERT(dir("./otherdb").empty());
+}
+
+static void TestMayHandle() {
+  const auto may_handle = [](long number, const char* x1, const char* x2 = nullptr) {
+    return SyscallHandler::MayHandle(number, reinterpret_cast<long>(x1), reinterpret_cast<long>(x2));
+  };
+
+  ASSERT(may_handle(SYS_open, "./mydb/mytab.frm"));
+  ASSERT(may_handle(SYS_open, "/data/mydb/db.opt"));
+  ASSERT(may_handle(SYS_open, "./mydb/mytab.frm~"));
+  ASSERT(!may_handle(SYS_open, "./#rocksdb/000042.sst"));
+  ASSERT(!may_handle(SYS_open, "frm"));
+  ASSERT(!may_handle(SYS_open, ""));
+  ASSERT(!may_handle(SYS_open, nullptr));
+
+  ASSERT(may_handle(SYS_stat, "./mydb/mytab.frm"));
+  ASSERT(!may_handle(SYS_stat, "./mydb/mytab.frm~"));
+  ASSERT(may_handle(SYS_unlink, "./mydb/db.opt"));
+  ASSERT(!may_handle(SYS_unlink, "./mydb/mytab.MAI"));
+
+  ASSERT(may_handle(SYS_access, "mydb/db.opt"));
+  ASSERT(may_handle(SYS_access, "./mydb"));
+  ASSERT(may_handle(SYS_access, "./mydb/"));
+  ASSERT(!may_handle(SYS_access, "/etc/hosts"));
+
+  ASSERT(may_handle(SYS_rename, "./mydb/a.frm", "./mydb/b.frm"));
+  ASSERT(may_handle(SYS_rename, "./mydb/a.frm~", "./mydb/b.frm"));
+  ASSERT(!may_handle(SYS_rename, "./mydb/a.frm", "./mydb/b.bak"));
+  ASSERT(!may_handle(SYS_rename, "./#rocksdb/a.log", "./#rocksdb/b.log"));
+
+  // other syscalls are never handled
+  ASSERT(!may_handle(SYS_read, "./mydb/mytab.frm"));
+  ASSERT(!may_handle(SYS_close, nullptr));
+}
+
+static void TestCachedStore() {
+  const auto backing = make_shared<FakeStore>();
+  backing->Put(kCfNameFrm, "./mydb/mytab.frm", "foo");
+  CachedStore store(backing, kDefaultMetadataCacheSize);
+
+  // second get is served from the cache
+  ASSERT("foo" == store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT("foo" == store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT(1 == backing->get_count);
+
+  // nonexistent keys are cached, too
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT(2 == backing->get_count);
+
+  // same key in another column family is a different entry
+  ASSERT(!store.Get(kCfNameDb, "./mydb/mytab.frm"));
+  ASSERT(3 == backing->get_count);
+
+  auto stats = store.GetStats();
+  ASSERT(2 == stats.hits);
+  ASSERT(3 == stats.misses);
+
+  // pinned values point to the cached data
+  const auto pinned1 = store.GetPinned(kCfNameFrm, "./mydb/mytab.frm");
+  const auto pinned2 = store.GetPinned(kCfNameFrm, "./mydb/mytab.frm");
+  ASSERT("foo" == pinned1->Data());
+  ASSERT(pinned1->Data().data() == pinned2->Data().data());
+  ASSERT(!store.GetPinned(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT(3 == backing->get_count);
+
+  // writes go through to the backing store and update the cache
+  store.Put(kCfNameFrm, "./mydb/othertab.frm", "bar");
+  ASSERT("bar" == backing->Get(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT("bar" == store.Get(kCfNameFrm, "./mydb/othertab.frm"));
+  store.Delete(kCfNameFrm, "./mydb/mytab.frm");
+  ASSERT(!backing->Get(kCfNameFrm, "./mydb/mytab.frm"));
+  backing->get_count = 0;
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT(0 == backing->get_count);
+
+  // a pinned value stays valid after the key has been overwritten
+  ASSERT("foo" == pinned1->Data());
+
+  // rename through the handler invalidates the old name
+  SyscallHandler handler(make_shared<CachedStore>(backing, kDefaultMetadataCacheSize));
+  const auto my_stat = [&handler](const char* path) {
+    struct stat st {};
+    return handler.Syscall(SYS_stat, reinterpret_cast<long>(path), reinterpret_cast<long>(&st));
+  };
+  ASSERT(0 == my_stat("./mydb/othertab.frm"));
+  ASSERT(-1 == my_stat("./mydb/newtab.frm"));
+  ASSERT(0 == handler.Syscall(SYS_rename, reinterpret_cast<long>("./mydb/othertab.frm"), reinterpret_cast<long>("./mydb/newtab.frm")));
+  ASSERT(-1 == my_stat("./mydb/othertab.frm"));
+  ASSERT(0 == my_stat("./mydb/newtab.frm"));
+
+  // batches update the cache
+  Store::WriteBatch batch;
+  batch.Put(kCfNameFrm, "./mydb/mytab.frm", "baz");
+  batch.Delete(kCfNameFrm, "./mydb/othertab.frm");
+  store.Write(batch);
+  backing->get_count = 0;
+  ASSERT("baz" == store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT(0 == backing->get_count);
+  ASSERT("baz" == backing->Get(kCfNameFrm, "./mydb/mytab.frm"));
+
+  // a value larger than a shard isn't cached and doesn't evict other entries
+  const string large(kDefaultMetadataCacheSize, 'x');
+  const auto evictions = store.GetStats().evictions;
+  store.Put(kCfNameFrm, "./mydb/mytab.frm", large);
+  ASSERT(evictions == store.GetStats().evictions);
+  backing->get_count = 0;
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/othertab.frm"));
+  ASSERT(0 == backing->get_count);
+  ASSERT(large == store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT(1 == backing->get_count);
+  store.Put(kCfNameFrm, "./mydb/mytab.frm", "baz");
+
+  // shrinking the capacity evicts entries
+  store.SetCapacity(0);
+  stats = store.GetStats();
+  ASSERT(0 == stats.size);
+  ASSERT(0 < stats.evictions);
+  backing->get_count = 0;
+  ASSERT("bar" == store.Get(kCfNameFrm, "./mydb/newtab.frm"));
+  ASSERT("bar" == store.Get(kCfNameFrm, "./mydb/newtab.frm"));
+  ASSERT(2 == backing->get_count);
+}
+
+static void TestCachedStorePrefetch() {
+  const auto backing = make_shared<FakeStore>();
+  for (const char* db : {"a", "b", "c"})
+    for (int i = 0; i < 10; ++i)
+      backing->Put(kCfNameFrm, "./"s + db + "/t" + to_string(i) + ".frm", string(100, 'x'));
+  CachedStore store(backing, kDefaultMetadataCacheSize);
+
+  // a value that is already cached is kept
+  store.Put(kCfNameFrm, "./a/t0.frm", "new");
+  backing->data.at(string(kCfNameFrm)).at("./a/t0.frm") = "old";
+
+  store.Prefetch(kCfNameFrm, {"./a/", "./b/"}, 2);
+  backing->get_count = 0;
+  ASSERT("new" == store.Get(kCfNameFrm, "./a/t0.frm"));
+  ASSERT(string(100, 'x') == store.Get(kCfNameFrm, "./a/t9.frm"));
+  ASSERT(string(100, 'x') == store.Get(kCfNameFrm, "./b/t5.frm"));
+  ASSERT(0 == backing->get_count);
+  ASSERT(string(100, 'x') == store.Get(kCfNameFrm, "./c/t5.frm"));
+  ASSERT(1 == backing->get_count);
+
+  // prefetch stops when the cache is full instead of evicting entries
+  CachedStore small_store(backing, 4096);
+  small_store.Prefetch(kCfNameFrm, {"./a/", "./b/", "./c/"}, 3);
+  auto stats = small_store.GetStats();
+  ASSERT(0 < stats.size && stats.size <= stats.capacity);
+  ASSERT(0 == stats.evictions);
+
+  // nothing is read if caching is disabled
+  CachedStore no_cache(backing, 0);
+  no_cache.Prefetch(kCfNameFrm, {"./a/"}, 1);
+  ASSERT(0 == no_cache.GetStats().size);
+}
+
+static void TestCompressedStore() {
+  const auto backing = make_shared<FakeStore>();
+  CompressedStore store(backing);
+  const string frm = "\xFE\x01" + string(4000, 'a') + string(4000, 'b');
+
+  // large values are stored compressed
+  store.Put(kCfNameFrm, "./mydb/mytab.frm", frm);
+  const auto stored = backing->Get(kCfNameFrm, "./mydb/mytab.frm");
+  ASSERT(stored && stored->size() < frm.size() / 10);
+  ASSERT(0 == stored->compare(0, CompressedStore::kMagic.size(), CompressedStore::kMagic));
+  ASSERT(frm == store.Get(kCfNameFrm, "./mydb/mytab.frm"));
+  ASSERT(frm == store.GetPinned(kCfNameFrm, "./mydb/mytab.frm")->Data());
+
+  // small values are stored as they are
+  store.Put(kCfNameDb, "./mydb/db.opt", "default-character-set=utf8mb4\n");
+  ASSERT("default-character-set=utf8mb4\n" == backing->Get(kCfNameDb, "./mydb/db.opt"));
+  ASSERT("default-character-set=utf8mb4\n" == store.Get(kCfNameDb, "./mydb/db.opt"));
+
+  // values written without compression can be read
+  backing->Put(kCfNameFrm, "./mydb/oldtab.frm", frm);
+  ASSERT(frm == store.Get(kCfNameFrm, "./mydb/oldtab.frm"));
+  ASSERT(frm == store.GetPinned(kCfNameFrm, "./mydb/oldtab.frm")->Data());
+
+  // values that look like a header are escaped
+  const string magic = string(CompressedStore::kMagic) + "\x01xyz";
+  store.Put(kCfNameFrm, "./mydb/magic.frm", magic);
+  ASSERT(magic != backing->Get(kCfNameFrm, "./mydb/magic.frm"));
+  ASSERT(magic == store.Get(kCfNameFrm, "./mydb/magic.frm"));
+  ASSERT(magic == store.GetPinned(kCfNameFrm, "./mydb/magic.frm")->Data());
+
+  // empty values
+  store.Put(kCfNameFrm, "./mydb/empty.frm", {});
+  ASSERT("" == store.Get(kCfNameFrm, "./mydb/empty.frm"));
+
+  // batches and scans
+  Store::WriteBatch batch;
+  batch.Put(kCfNameFrm, "./mydb/batch.frm", frm);
+  batch.Delete(kCfNameFrm, "./mydb/empty.frm");
+  store.Write(batch);
+  ASSERT(backing->Get(kCfNameFrm, "./mydb/batch.frm")->size() < frm.size());
+  ASSERT(!store.Get(kCfNameFrm, "./mydb/empty.frm"));
+  size_t count = 0;
+  store.ForEach(kCfNameFrm, "./mydb/", [&](string_view key, string_view value) {
+    ++count;
+    ASSERT(value == (key == "./mydb/magic.frm" ? magic : frm));
+    return true;
+  });
+  ASSERT(4 == count);
+
+  // corrupted values are detected
+  backing->Put(kCfNameFrm, "./mydb/bad.frm", stored->substr(0, stored->size() - 1));
+  bool thrown = false;
+  try {
+    store.Get(kCfNameFrm, "./mydb/bad.frm");
+  } catch (const runtime_error&) {
+    thrown = true;
+  }
+  ASSERT(thrown);
+}
+
+static void TestParsePath() {
+  constexpr auto frm = ParsePath("./mydb/mytab.frm");
+  static_assert(PathKind::kFrm == frm.kind);
+  static_assert("mydb" == frm.db);
+  static_assert("mytab" == frm.table);
+
+  constexpr auto temp_frm = ParsePath("./mydb/#sql-1_2.frm~");
+  static_assert(PathKind::kTempFrm == temp_frm.kind);
+  static_assert("#sql-1_2" == temp_frm.table);
+
+  constexpr auto opt = ParsePath("./mydb/db.opt");
+  static_assert(PathKind::kDbOpt == opt.kind);
+  static_assert("mydb" == opt.db);
+  static_assert(opt.table.empty());
+
+  static_assert(PathKind::kFolder == ParsePath("./mydb").kind);
+  static_assert(PathKind::kFolder == ParsePath("./mydb/").kind);
+  static_assert(PathKind::kFrm == ParsePath("./mydb/db.frm").kind);
+  static_assert(PathKind::kDbOpt == ParseRelativePath("mydb/db.opt").kind);
+
+  // not handled
+  static_assert(PathKind::kNone == ParsePath("").kind);
+  static_assert(PathKind::kNone == ParsePath(".").kind);
+  static_assert(PathKind::kNone == ParsePath("./").kind);
+  static_assert(PathKind::kNone == ParsePath("mydb/db.opt").kind);
+  static_assert(PathKind::kNone == ParsePath("/data/mydb/db.opt").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb//").kind);
+  static_assert(PathKind::kNone == ParsePath("./my.db/db.opt").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb/other.opt").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb/.frm").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb/my.tab.frm").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb/mytab.frm/").kind);
+  static_assert(PathKind::kNone == ParsePath("./mydb/sub/mytab.frm").kind);
+  static_assert(PathKind::kNone == ParsePath("./#rocksdb/000042.sst").kind);
+
+  // views point into the input
+  const string path = "./mydb/mytab.frm";
+  const auto info = ParsePath(path);
+  ASSERT(path.data() + 2 == info.db.data());
+  ASSERT(path.data() + 7 == info.table.data());
+}
+
+static void TestMetrics() {
+  // counters are summed over all threads
+  metrics::Counter counter;
+  vector<thread> threads;
+  for (int i = 0; i < 20; ++i)
+    threads.emplace_back([&counter] {
+      for (int j = 0; j < 100; ++j)
+        counter.Add();
+    });
+  for (auto& t : threads)
+    t.join();
+  ASSERT(2000 == counter.Get());
+
+  metrics::Histogram histogram;
+  histogram.Observe(500ns);
+  histogram.Observe(1500ns);
+  histogram.Observe(10s);
+  string out;
+  histogram.Render(out, "test_seconds", "Test.");
+  ASSERT(out.find("# TYPE test_seconds histogram\n") != string::npos);
+  ASSERT(out.find("test_seconds_bucket{le=\"0.000001\"} 1\n") != string::npos);
+  ASSERT(out.find("test_seconds_bucket{le=\"0.000002\"} 2\n") != string::npos);
+  ASSERT(out.find("test_seconds_bucket{le=\"+Inf\"} 3\n") != string::npos);
+  ASSERT(out.find("test_seconds_count 3\n") != string::npos);
+
+  // only one in kTimerSampleRate timers reads the clock, and it is counted for all of them
+  metrics::Histogram timed;
+  for (uint64_t i = 0; i < metrics::kTimerSampleRate; ++i)
+    const metrics::ScopedTimer timer(timed);
+  out.clear();
+  timed.Render(out, "timed_seconds", "Test.");
+  ASSERT(out.find("timed_seconds_count " + to_string(metrics::kTimerSampleRate) + '\n') != string::npos);
+
+  // opening a file is counted
+  const auto store = make_shared<FakeStore>();
+  store->Put(kCfNameDb, "./mydb/db.opt", "foo");
+  SyscallHandler handler(store);
+  oe_fd_t* file = nullptr;
+  fdtable_assign = [&file](oe_fd_t* desc) {
+    file = desc;
+    return 2;
+  };
+  const uint64_t opened = metrics::files_opened.Get();
+  ASSERT(2 == handler.Syscall(SYS_open, reinterpret_cast<long>("./mydb/db.opt"), O_RDONLY));
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT(opened + 1 == metrics::files_opened.Get());
+  ASSERT(metrics::Render().find("edb_files_opened_total " + to_string(opened + 1) + '\n') != string::npos);
+}
+
+static void TestTempFile() {
+  SyscallHandler handler(make_shared<FakeStore>());
+
+  oe_fd_t* file = nullptr;
+  fdtable_assign = [&file](oe_fd_t* desc) {
+    file = desc;
+    return 2;
+  };
+  const auto open_temp = [&handler](const char* dir) {
+    return handler.Syscall(SYS_open, reinterpret_cast<long>(dir), O_TMPFILE | O_RDWR);
+  };
+
+  ASSERT(SyscallHandler::MayHandle(SYS_open, reinterpret_cast<long>("/tmp"), O_TMPFILE | O_RDWR));
+  ASSERT(!open_temp("/data"));
+
+  string in(200000, '\0');
+  for (size_t i = 0; i < in.size(); ++i)
+    in[i] = static_cast<char>(i * 7);
+  string out(in.size(), '\0');
+
+  // without spilling, the file stays in memory
+  ASSERT(2 == open_temp("/tmp/"));
+  ASSERT(1 == GetTempFileStats().files);
+  ASSERT(static_cast<ssize_t>(in.size()) == file->ops.fd.write(file, in.data(), in.size()));
+  ASSERT(in.size() == GetTempFileStats().memory_size);
+  ASSERT(static_cast<ssize_t>(in.size()) == file->ops.file.pread(file, out.data(), out.size(), 0));
+  ASSERT(in == out);
+  ASSERT(0 == file->ops.fd.close(file));
+  ASSERT(0 == GetTempFileStats().files);
+  ASSERT(0 == GetTempFileStats().memory_size);
+
+  char dir[] = "/tmp/edb_test_XXXXXX";
+  ASSERT(mkdtemp(dir));
+  SetTempFileSpill(dir, 100000);
+
+  // the write that exceeds the threshold moves the file to the host
+  ASSERT(2 == open_temp("/tmp"));
+  ASSERT(50000 == file->ops.fd.write(file, in.data(), 50000));
+  ASSERT(50000 == GetTempFileStats().memory_size);
+  ASSERT(150000 == file->ops.fd.write(file, in.data() + 50000, 150000));
+  auto stats = GetTempFileStats();
+  ASSERT(0 == stats.memory_size);
+  ASSERT(in.size() == stats.spilled_size);
+  ASSERT(1 == stats.spilled_files);
+
+  // reads across blocks
+  fill(out.begin(), out.end(), '\0');
+  ASSERT(static_cast<ssize_t>(in.size()) == file->ops.file.pread(file, out.data(), out.size(), 0));
+  ASSERT(in == out);
+  ASSERT(1000 == file->ops.file.pread(file, out.data(), 1000, 65000));
+  ASSERT(in.substr(65000, 1000) == out.substr(0, 1000));
+
+  // small unaligned writes across a block boundary
+  ASSERT(3 == file->ops.file.pwrite(file, "abc", 3, 65535));
+  in.replace(65535, 3, "abc");
+  ASSERT(static_cast<ssize_t>(in.size()) == file->ops.file.pread(file, out.data(), out.size(), 0));
+  ASSERT(in == out);
+
+  // truncated data reads as zeros when the file grows again
+  ASSERT(0 == file->ops.file.ftruncate(file, 100));
+  ASSERT(0 == file->ops.file.ftruncate(file, 70000));
+  ASSERT(70000 == file->ops.file.lseek(file, 0, SEEK_END));
+  ASSERT(70000 == file->ops.file.pread(file, out.data(), out.size(), 0));
+  ASSERT(in.substr(0, 100) + string(69900, '\0') == out.substr(0, 70000));
+  ASSERT(70000 == GetTempFileStats().spilled_size);
+
+  ASSERT(0 == file->ops.fd.close(file));
+  stats = GetTempFileStats();
+  ASSERT(0 == stats.files);
+  ASSERT(0 == stats.spilled_size);
+
+  // the host file has been unlinked on creation
+  ASSERT(0 == rmdir(dir));
 }
 
 int main() {
+  TestParsePath();
   TestAccess();
   TestFile();
+  TestFileBuffering();
+  TestFilePositionalAndVectored();
+  TestFileSharing();
   TestOpenError();
   TestStat();
   TestRename();
   TestUnlink();
   TestDir();
+  TestMayHandle();
+  TestCachedStore();
+  TestCachedStorePrefetch();
+  TestCompressedStore();
+  TestMetrics();
+  TestTempFile();
   cout << "pass\n";
 }
 
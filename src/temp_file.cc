@@ -0,0 +1,604 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#include "temp_file.h"
+
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "oe_internal.h"
+
+using namespace std;
+using namespace edb;
+
+namespace edb {
+// defined in syscall_file.cc
+extern function<decltype(oe_fdtable_assign)> fdtable_assign;
+}  // namespace edb
+
+// Host files are encrypted in blocks of this size. Filesort reads and writes sequentially in large chunks, so large
+// blocks mean few ocalls and little space for the tags in enclave memory.
+static constexpr size_t kBlockSize = 64 * 1024;
+static constexpr size_t kKeySize = 32;
+static constexpr size_t kNonceSize = 12;
+static constexpr size_t kTagSize = 16;
+static constexpr size_t kNoBlock = numeric_limits<size_t>::max();
+
+static atomic<uint64_t> open_files;
+static atomic<uint64_t> memory_size;
+static atomic<uint64_t> spilled_size;
+static atomic<uint64_t> spilled_files;
+
+static atomic<bool> spill_enabled;
+static atomic<size_t> spill_threshold;
+static mutex spill_dir_mutex;
+static string spill_dir;
+
+namespace {
+struct CipherCtxDeleter {
+  void operator()(EVP_CIPHER_CTX* ctx) const noexcept {
+    EVP_CIPHER_CTX_free(ctx);
+  }
+};
+
+struct Block {
+  uint32_t counter = 0;  // number of times the block has been encrypted, never reset so that nonces are unique
+  bool written = false;  // false if the block reads as zeros
+  array<unsigned char, kTagSize> tag{};
+};
+
+// Encrypted file on the host
+struct HostFile {
+  HostFile() = default;
+  HostFile(const HostFile&) = delete;
+  HostFile& operator=(const HostFile&) = delete;
+
+  ~HostFile() {
+    OPENSSL_cleanse(key.data(), key.size());
+    if (fd >= 0)
+      close(fd);
+  }
+
+  int fd = -1;
+  array<unsigned char, kKeySize> key{};
+  const unique_ptr<EVP_CIPHER_CTX, CipherCtxDeleter> ctx{EVP_CIPHER_CTX_new()};
+  vector<Block> blocks;
+
+  // One block is cached in plaintext so that small sequential reads and writes don't need a host call each.
+  size_t cached = kNoBlock;
+  bool dirty = false;
+  string plaintext = string(kBlockSize, '\0');
+  string ciphertext = string(kBlockSize, '\0');
+};
+
+struct TempFile {
+  oe_fd_t base{};
+  mutex mut;
+  size_t offset = 0;
+  size_t size = 0;
+  string data;                // content while the file is in enclave memory
+  unique_ptr<HostFile> host;  // set after the file has been spilled
+};
+}  // namespace
+
+static array<unsigned char, kNonceSize> Nonce(size_t block, uint32_t counter) noexcept {
+  array<unsigned char, kNonceSize> nonce{};
+  const uint64_t block64 = block;
+  memcpy(nonce.data(), &block64, sizeof block64);
+  memcpy(nonce.data() + sizeof block64, &counter, sizeof counter);
+  return nonce;
+}
+
+static void PreadFull(int fd, char* buf, size_t count, size_t offset) {
+  while (count) {
+    const ssize_t res = pread(fd, buf, count, offset);
+    if (res <= 0)
+      throw runtime_error("temp file: host read failed");
+    buf += res;
+    count -= res;
+    offset += res;
+  }
+}
+
+static void PwriteFull(int fd, const char* buf, size_t count, size_t offset) {
+  while (count) {
+    const ssize_t res = pwrite(fd, buf, count, offset);
+    if (res <= 0)
+      throw runtime_error("temp file: host write failed");
+    buf += res;
+    count -= res;
+    offset += res;
+  }
+}
+
+// Reads and decrypts block i into host.plaintext.
+static void LoadBlock(HostFile& host, size_t i) {
+  if (i >= host.blocks.size() || !host.blocks[i].written) {
+    fill(host.plaintext.begin(), host.plaintext.end(), '\0');
+    return;
+  }
+
+  const Block& block = host.blocks[i];
+  PreadFull(host.fd, host.ciphertext.data(), kBlockSize, i * kBlockSize);
+
+  const auto nonce = Nonce(i, block.counter);
+  auto tag = block.tag;
+  int len = 0;
+  if (EVP_DecryptInit_ex(host.ctx.get(), EVP_aes_256_gcm(), nullptr, host.key.data(), nonce.data()) != 1 ||
+      EVP_DecryptUpdate(host.ctx.get(), reinterpret_cast<unsigned char*>(host.plaintext.data()), &len,
+                        reinterpret_cast<const unsigned char*>(host.ciphertext.data()), kBlockSize) != 1 ||
+      EVP_CIPHER_CTX_ctrl(host.ctx.get(), EVP_CTRL_GCM_SET_TAG, kTagSize, tag.data()) != 1 ||
+      EVP_DecryptFinal_ex(host.ctx.get(), reinterpret_cast<unsigned char*>(host.plaintext.data()) + len, &len) != 1)
+    throw runtime_error("temp file: host data has been modified");
+}
+
+// Encrypts host.plaintext and writes it to block i.
+static void StoreBlock(HostFile& host, size_t i) {
+  if (host.blocks.size() <= i)
+    host.blocks.resize(i + 1);
+  Block& block = host.blocks[i];
+  if (block.counter == numeric_limits<uint32_t>::max())
+    throw runtime_error("temp file: block has been written too often");
+  ++block.counter;
+
+  const auto nonce = Nonce(i, block.counter);
+  array<unsigned char, kTagSize> tag{};
+  int len = 0;
+  if (EVP_EncryptInit_ex(host.ctx.get(), EVP_aes_256_gcm(), nullptr, host.key.data(), nonce.data()) != 1 ||
+      EVP_EncryptUpdate(host.ctx.get(), reinterpret_cast<unsigned char*>(host.ciphertext.data()), &len,
+                        reinterpret_cast<const unsigned char*>(host.plaintext.data()), kBlockSize) != 1 ||
+      EVP_EncryptFinal_ex(host.ctx.get(), reinterpret_cast<unsigned char*>(host.ciphertext.data()) + len, &len) != 1 ||
+      EVP_CIPHER_CTX_ctrl(host.ctx.get(), EVP_CTRL_GCM_GET_TAG, kTagSize, tag.data()) != 1)
+    throw runtime_error("temp file: encryption failed");
+
+  PwriteFull(host.fd, host.ciphertext.data(), kBlockSize, i * kBlockSize);
+  block.tag = tag;
+  block.written = true;
+}
+
+// Makes block i the cached block. If load is false, the caller will overwrite the whole block.
+static void CacheBlock(HostFile& host, size_t i, bool load = true) {
+  if (host.cached == i)
+    return;
+  if (host.dirty) {
+    StoreBlock(host, host.cached);
+    host.dirty = false;
+  }
+  host.cached = kNoBlock;
+  if (load)
+    LoadBlock(host, i);
+  host.cached = i;
+}
+
+// The following functions must be called with file.mut held.
+
+static void SetSize(TempFile& file, size_t size) {
+  if (file.host) {
+    spilled_size += size;
+    spilled_size -= file.size;
+  } else {
+    // resize first so that the counters stay correct if it throws
+    file.data.resize(size);
+    memory_size += size;
+    memory_size -= file.size;
+  }
+  file.size = size;
+}
+
+// Moves the file to an encrypted host file.
+static void Spill(TempFile& file) {
+  string path;
+  {
+    const lock_guard lock(spill_dir_mutex);
+    path = spill_dir + "/edb-tmp-XXXXXX";
+  }
+
+  auto host = make_unique<HostFile>();
+  if (!host->ctx)
+    throw bad_alloc();
+  if (RAND_bytes(host->key.data(), kKeySize) != 1)
+    throw runtime_error("temp file: RAND_bytes failed");
+  host->fd = mkstemp(path.data());
+  if (host->fd < 0)
+    throw runtime_error("temp file: can't create " + path + ": " + strerror(errno));
+  unlink(path.c_str());
+
+  // write all blocks of the file
+  for (size_t offset = 0; offset < file.size; offset += kBlockSize) {
+    const size_t count = min(kBlockSize, file.size - offset);
+    memcpy(host->plaintext.data(), file.data.data() + offset, count);
+    fill(host->plaintext.begin() + count, host->plaintext.end(), '\0');
+    StoreBlock(*host, offset / kBlockSize);
+  }
+
+  file.host = move(host);
+  memory_size -= file.size;
+  spilled_size += file.size;
+  ++spilled_files;
+  string().swap(file.data);
+}
+
+// Changes the size of the file. The new bytes are zeros.
+static void Resize(TempFile& file, size_t size) {
+  if (!file.host && size > file.size && spill_enabled && memory_size + (size - file.size) > spill_threshold) {
+    try {
+      Spill(file);
+    } catch (const exception& ex) {
+      // keep the file in enclave memory
+      oe_log(OE_LOG_LEVEL_ERROR, "temp file: spilling failed: %s\n", ex.what());
+    }
+  }
+
+  if (file.host && size < file.size) {
+    // Truncated blocks read as zeros, and so must the end of the last block, in case the file grows again.
+    HostFile& host = *file.host;
+    const size_t blocks = (size + kBlockSize - 1) / kBlockSize;
+    for (size_t i = blocks; i < host.blocks.size(); ++i)
+      host.blocks[i].written = false;
+    if (host.cached >= blocks) {
+      host.cached = kNoBlock;
+      host.dirty = false;
+    }
+    if (size % kBlockSize) {
+      CacheBlock(host, size / kBlockSize);
+      fill(host.plaintext.begin() + size % kBlockSize, host.plaintext.end(), '\0');
+      host.dirty = true;
+    }
+    if (ftruncate(host.fd, blocks * kBlockSize) != 0)
+      oe_log(OE_LOG_LEVEL_WARNING, "temp file: can't truncate host file\n");
+  }
+
+  SetSize(file, size);
+}
+
+static size_t ReadAt(TempFile& file, void* buf, size_t count, size_t offset) {
+  if (file.size <= offset)
+    return 0;
+  count = min(count, file.size - offset);
+
+  if (!file.host) {
+    memcpy(buf, file.data.data() + offset, count);
+    return count;
+  }
+
+  HostFile& host = *file.host;
+  auto dest = static_cast<char*>(buf);
+  for (size_t remaining = count; remaining;) {
+    const size_t block_offset = offset % kBlockSize;
+    const size_t n = min(remaining, kBlockSize - block_offset);
+    CacheBlock(host, offset / kBlockSize);
+    memcpy(dest, host.plaintext.data() + block_offset, n);
+    dest += n;
+    offset += n;
+    remaining -= n;
+  }
+  return count;
+}
+
+// Returns false if the file would become too large.
+static bool WriteAt(TempFile& file, const void* buf, size_t count, size_t offset) {
+  const size_t end = offset + count;
+  if (end < offset)
+    return false;
+  if (file.size < end)
+    Resize(file, end);
+
+  if (!file.host) {
+    memcpy(file.data.data() + offset, buf, count);
+    return true;
+  }
+
+  HostFile& host = *file.host;
+  auto src = static_cast<const char*>(buf);
+  while (count) {
+    const size_t block_offset = offset % kBlockSize;
+    const size_t n = min(count, kBlockSize - block_offset);
+    CacheBlock(host, offset / kBlockSize, n < kBlockSize);
+    memcpy(host.plaintext.data() + block_offset, src, n);
+    host.dirty = true;
+    src += n;
+    offset += n;
+    count -= n;
+  }
+  return true;
+}
+
+static ssize_t temp_read(oe_fd_t* desc, void* buf, size_t count) {
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    const size_t res = ReadAt(file, buf, count, file.offset);
+    file.offset += res;
+    return res;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_read: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static ssize_t temp_write(oe_fd_t* desc, const void* buf, size_t count) {
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    if (!WriteAt(file, buf, count, file.offset)) {
+      errno = EFBIG;
+      return -1;
+    }
+    file.offset += count;
+    return count;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_write: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static ssize_t temp_readv(oe_fd_t* desc, const oe_iovec* iov, int iovcnt) {
+  if (iovcnt < 0 || (iovcnt && !iov)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    size_t res = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      const size_t count = ReadAt(file, iov[i].iov_base, iov[i].iov_len, file.offset);
+      file.offset += count;
+      res += count;
+      if (count < iov[i].iov_len)
+        break;
+    }
+    return res;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_readv: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static ssize_t temp_writev(oe_fd_t* desc, const oe_iovec* iov, int iovcnt) {
+  if (iovcnt < 0 || (iovcnt && !iov)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    size_t res = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+      if (!WriteAt(file, iov[i].iov_base, iov[i].iov_len, file.offset)) {
+        if (res)
+          break;
+        errno = EFBIG;
+        return -1;
+      }
+      file.offset += iov[i].iov_len;
+      res += iov[i].iov_len;
+    }
+    return res;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_writev: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static int temp_dup(oe_fd_t* /*desc*/, oe_fd_t** /*new_file_out*/) {
+  errno = ENOSYS;
+  return -1;
+}
+
+static int temp_ioctl(oe_fd_t* /*desc*/, unsigned long /*request*/, uint64_t /*arg*/) {
+  errno = ENOSYS;
+  return -1;
+}
+
+static int temp_fcntl(oe_fd_t* /*desc*/, int /*cmd*/, uint64_t /*arg*/) {
+  errno = ENOSYS;
+  return -1;
+}
+
+static int temp_close(oe_fd_t* desc) {
+  const unique_ptr<TempFile> file(reinterpret_cast<TempFile*>(desc));
+  (file->host ? spilled_size : memory_size) -= file->size;
+  --open_files;
+  return 0;
+}
+
+static oe_host_fd_t temp_get_host_fd(oe_fd_t* /*desc*/) {
+  errno = ENOSYS;
+  return -1;
+}
+
+static oe_off_t temp_lseek(oe_fd_t* desc, oe_off_t offset, int whence) {
+  auto& file = *reinterpret_cast<TempFile*>(desc);
+  const lock_guard lock(file.mut);
+
+  switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      offset += file.offset;
+      break;
+    case SEEK_END:
+      offset += file.size;
+      break;
+    default:
+      errno = EINVAL;
+      return -1;
+  }
+
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  file.offset = offset;
+  return offset;
+}
+
+static ssize_t temp_pread(oe_fd_t* desc, void* buf, size_t count, oe_off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    return ReadAt(file, buf, count, offset);
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_pread: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static ssize_t temp_pwrite(oe_fd_t* desc, const void* buf, size_t count, oe_off_t offset) {
+  if (offset < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    if (!WriteAt(file, buf, count, offset)) {
+      errno = EFBIG;
+      return -1;
+    }
+    return count;
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_pwrite: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+}
+
+static int temp_getdents64(
+    oe_fd_t* /*desc*/,
+    struct oe_dirent* /*dirp*/,
+    unsigned int /*count*/) {
+  errno = ENOSYS;
+  return -1;
+}
+
+static int temp_fstat(oe_fd_t* desc, struct oe_stat_t* buf) {
+  auto& st = *reinterpret_cast<struct stat*>(buf);
+
+  // see file_fstat in syscall_file.cc
+  constexpr size_t sizeof_oe_stat = 120;
+  static_assert(sizeof_oe_stat < sizeof st);
+  memset(&st, 0, sizeof_oe_stat);
+
+  auto& file = *reinterpret_cast<TempFile*>(desc);
+  const lock_guard lock(file.mut);
+  st.st_mode = S_IFREG | S_IRUSR | S_IWUSR;
+  st.st_size = file.size;
+  return 0;
+}
+
+static int temp_ftruncate(oe_fd_t* desc, oe_off_t length) {
+  if (length < 0) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    auto& file = *reinterpret_cast<TempFile*>(desc);
+    const lock_guard lock(file.mut);
+    Resize(file, length);
+  } catch (const exception& ex) {
+    oe_log(OE_LOG_LEVEL_ERROR, "temp_ftruncate: %s\n", ex.what());
+    errno = EIO;
+    return -1;
+  }
+  return 0;
+}
+
+// Temp files don't survive a restart, so there is nothing to sync.
+static int temp_fsync(oe_fd_t* /*desc*/) {
+  return 0;
+}
+
+int edb::OpenTempFile() {
+  auto file = make_unique<TempFile>();
+  file->base.type = OE_FD_TYPE_FILE;
+
+  auto& ops = file->base.ops;
+  ops.fd.read = temp_read;
+  ops.fd.write = temp_write;
+  ops.fd.readv = temp_readv;
+  ops.fd.writev = temp_writev;
+  ops.fd.dup = temp_dup;
+  ops.fd.ioctl = temp_ioctl;
+  ops.fd.fcntl = temp_fcntl;
+  ops.fd.close = temp_close;
+  ops.fd.get_host_fd = temp_get_host_fd;
+  ops.file.lseek = temp_lseek;
+  ops.file.pread = temp_pread;
+  ops.file.pwrite = temp_pwrite;
+  ops.file.getdents64 = temp_getdents64;
+  ops.file.fstat = temp_fstat;
+  ops.file.ftruncate = temp_ftruncate;
+  ops.file.fsync = temp_fsync;
+  ops.file.fdatasync = temp_fsync;
+
+  const int fd = fdtable_assign(&file->base);
+  if (fd < 0)
+    return -1;
+
+  (void)file.release();
+  ++open_files;
+  return fd;
+}
+
+void edb::SetTempFileSpill(std::string dir, size_t threshold) {
+  assert(!dir.empty());
+  {
+    const lock_guard lock(spill_dir_mutex);
+    spill_dir = move(dir);
+  }
+  spill_threshold = threshold;
+  spill_enabled = true;
+}
+
+TempFileStats edb::GetTempFileStats() noexcept {
+  return {open_files, memory_size, spilled_size, spilled_files};
+}
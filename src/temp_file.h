@@ -0,0 +1,53 @@
+/* Copyright (c) Edgeless Systems GmbH
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; version 2 of the License.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program; if not, write to the Free Software
+   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1335  USA */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace edb {
+
+// Files opened with O_TMPFILE in this directory are handled by OpenTempFile.
+constexpr std::string_view kTempDir = "/tmp";
+
+struct TempFileStats {
+  uint64_t files;          // open temp files
+  uint64_t memory_size;    // bytes held in enclave memory
+  uint64_t spilled_size;   // bytes held in encrypted host files
+  uint64_t spilled_files;  // files that have been moved to the host since start
+};
+
+/*
+Temp files are the anonymous files that MariaDB creates with O_TMPFILE, e.g., for filesort and for caches of large
+query results. By default, they are kept in enclave memory, like all files in memfs, but their size is accounted.
+
+If spilling is enabled, a write that would let the temp files in enclave memory grow beyond the threshold moves the
+written file to an unlinked file in the host directory. The host file is encrypted with AES-GCM under a key that is
+generated for each file and never leaves the enclave. The tag and a write counter of each block are kept in enclave
+memory, so the host can neither read nor modify or replay the data.
+*/
+
+// Opens a new temp file. Returns an fd.
+int OpenTempFile();
+
+// Enables spilling to dir, which must be a host directory as seen from the enclave. threshold is in bytes.
+void SetTempFileSpill(std::string dir, size_t threshold);
+
+TempFileStats GetTempFileStats() noexcept;
+
+}  // namespace edb